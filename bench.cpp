@@ -0,0 +1,762 @@
+#include "chess_board.h"
+#include "chess_eval.h"
+#include "chess_history.h"
+#include "chess_input.h"
+#include "chess_json.h"
+#include "chess_mate.h"
+#include "chess_move_picker.h"
+#include "chess_nnue.h"
+#include "chess_pieces.h"
+#include "chess_position.h"
+#include "chess_search.h"
+#include "chess_server.h"
+#include "chess_spectator.h"
+#include "chess_stats.h"
+#include "chess_tt.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <ncurses.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static volatile int gSink;
+
+class BenchRunner {
+public:
+    struct Result {
+        std::string name;
+        long        ops_per_rep;
+        double      median_ns;
+        double      p99_ns;
+        double      min_ns;
+        double      mean_ns;
+    };
+
+    BenchRunner(int warmup, int repetitions, const char *filter)
+        : warmup(warmup), repetitions(repetitions), filter(filter)
+    {
+    }
+
+    // Runs `op` ops_per_rep times per repetition and records ns per op.
+    template <class Op>
+    void Run(const char *name, long ops_per_rep, Op op);
+
+    void PrintTable(FILE *out) const;
+    void PrintJson(FILE *out) const;
+
+private:
+    int                 warmup;
+    int                 repetitions;
+    const char         *filter;
+    std::vector<Result> results;
+};
+
+template <class Op>
+void BenchRunner::Run(const char *name, long ops_per_rep, Op op)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    if (filter && !strstr(name, filter))
+        return;
+
+    std::vector<double> samples;
+    samples.reserve(repetitions);
+
+    for (int rep = -warmup; rep < repetitions; ++rep) {
+        Clock::time_point start = Clock::now();
+        for (long i = 0; i < ops_per_rep; ++i)
+            op();
+        Clock::time_point end = Clock::now();
+
+        if (rep >= 0) {
+            double ns = std::chrono::duration<double, std::nano>(end - start)
+                            .count();
+            samples.push_back(ns / ops_per_rep);
+        }
+    }
+
+    std::sort(samples.begin(), samples.end());
+
+    Result result;
+    result.name        = name;
+    result.ops_per_rep = ops_per_rep;
+    result.median_ns   = samples[samples.size() / 2];
+    result.p99_ns      = samples[(samples.size() * 99 + 99) / 100 - 1];
+    result.min_ns      = samples.front();
+    result.mean_ns     = 0;
+    for (double s : samples)
+        result.mean_ns += s;
+    result.mean_ns /= samples.size();
+
+    results.push_back(result);
+}
+
+void BenchRunner::PrintTable(FILE *out) const
+{
+    fprintf(out, "%-32s %10s %12s %12s %12s\n", "benchmark", "ops/rep",
+            "median ns", "p99 ns", "min ns");
+    for (const Result &r : results) {
+        fprintf(out, "%-32s %10ld %12.1f %12.1f %12.1f\n", r.name.c_str(),
+                r.ops_per_rep, r.median_ns, r.p99_ns, r.min_ns);
+    }
+}
+
+void BenchRunner::PrintJson(FILE *out) const
+{
+    fprintf(out, "{\n  \"context\": {\"compiler\": \"%s\", \"warmup\": %d, "
+                 "\"repetitions\": %d},\n",
+            __VERSION__, warmup, repetitions);
+    fprintf(out, "  \"benchmarks\": [\n");
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result &r = results[i];
+        fprintf(out,
+                "    {\"name\": \"%s\", \"ops_per_rep\": %ld, "
+                "\"median_ns\": %.2f, \"p99_ns\": %.2f, \"min_ns\": %.2f, "
+                "\"mean_ns\": %.2f}%s\n",
+                JsonEscape(r.name).c_str(), r.ops_per_rep, r.median_ns,
+                r.p99_ns, r.min_ns, r.mean_ns,
+                i + 1 < results.size() ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+}
+
+static void ClearBoard(ChessBoard &board)
+{
+    for (int y = 0; y < kBoardSize; ++y) {
+        for (int x = 0; x < kBoardSize; ++x) {
+            delete board.board[y][x];
+            board.board[y][x] = nullptr;
+        }
+    }
+}
+
+// Sets up a curses screen writing to /dev/null so that drawing code runs
+// exactly as in the game without a real terminal attached.
+static SCREEN *OpenBenchTerminal()
+{
+    SCREEN *screen = OpenNullTerminal();
+    if (!screen)
+        return nullptr;
+
+    ChessBoard::InitColors();
+    return screen;
+}
+
+static void BenchMovePiece(BenchRunner &runner)
+{
+    ChessBoard  board;
+    MoveHistory history;
+    bool        forth = true;
+
+    // Knight hops g1-f3-g1, so every call is a legal, accepted move.
+    runner.Run("MovePiece/accepted", 1000, [&]() {
+        if (forth)
+            gSink = board.MovePiece(TeamID::White, 6, 7, 5, 5, history);
+        else
+            gSink = board.MovePiece(TeamID::White, 5, 5, 6, 7, history);
+        forth = !forth;
+    });
+
+    // Rook a1-a5 is blocked by its own pawn.
+    runner.Run("MovePiece/rejected", 1000, [&]() {
+        gSink = board.MovePiece(TeamID::White, 0, 7, 0, 3, history);
+    });
+}
+
+struct CanMoveCase {
+    const char *name;
+    ChessPiece *piece;
+    int         from_x, from_y, to_x, to_y;
+};
+
+static void BenchCanMovePiece(BenchRunner &runner)
+{
+    ChessBoard  board;
+    MoveHistory history;
+    ClearBoard(board);
+
+    // Each piece gets the longest legal path the empty board allows, so
+    // sliding pieces scan their full ray.
+    CanMoveCase cases[] = {
+        {"CanMovePiece/pawn", new PawnPiece(TeamID::White), 4, 6, 4, 5},
+        {"CanMovePiece/knight", new KnightPiece(TeamID::White), 1, 7, 2, 5},
+        {"CanMovePiece/bishop", new BishopPiece(TeamID::White), 0, 7, 7, 0},
+        {"CanMovePiece/rook", new RookPiece(TeamID::White), 0, 7, 0, 0},
+        {"CanMovePiece/queen", new QueenPiece(TeamID::White), 7, 7, 0, 0},
+        {"CanMovePiece/king", new KingPiece(TeamID::White), 4, 4, 4, 3},
+    };
+
+    for (CanMoveCase &c : cases) {
+        board.board[c.from_y][c.from_x] = c.piece;
+        runner.Run(c.name, 1000, [&]() {
+            gSink = c.piece->CanMovePiece(c.from_x, c.from_y, c.to_x, c.to_y,
+                                          board.board, history);
+        });
+        board.board[c.from_y][c.from_x] = nullptr;
+        delete c.piece;
+    }
+}
+
+static void BenchCheckForCheckMate(BenchRunner &runner)
+{
+    ChessBoard  board;
+    MoveHistory history;
+
+    runner.Run("CheckForCheckMate/start", 100, [&]() {
+        gSink = board.CheckForCheckMate(TeamID::White, history);
+    });
+}
+
+static void BenchDrawBoard(BenchRunner &runner)
+{
+    SCREEN *screen = OpenBenchTerminal();
+    if (!screen) {
+        fprintf(stderr, "bench: no terminal description, skipping DrawBoard\n");
+        return;
+    }
+
+    ChessBoard board;
+    board.DrawBoardBorder();
+
+    runner.Run("DrawBoard", 100, [&]() { board.DrawBoard(); });
+
+    // Forces curses to emit the whole frame instead of an empty diff.
+    runner.Run("DrawBoard/full-refresh", 100, [&]() {
+        board.DrawBoard();
+        touchwin(stdscr);
+        refresh();
+    });
+
+    endwin();
+    delscreen(screen);
+}
+
+// Every game moves once per frame, so each tile has a couple of cells to
+// redraw; the screen is big enough for 64 full-size tiles.
+static void BenchSpectator(BenchRunner &runner)
+{
+    const int kGames = 64;
+
+    ChessPosition position;
+    BoardSnapshot snapshots[2];
+    position.SetFromFen(ChessPosition::kStartFen);
+    snapshots[0].Fill(0, 0, position, BoardSnapshot::Playing);
+    position.MakeMove(position.ParseMove("g1f3"));
+    snapshots[1].Fill(0, 1, position, BoardSnapshot::Playing);
+
+    SnapshotQueue queue(kGames);
+    BoardSnapshot popped;
+    runner.Run("Spectator/push-pop", 1000, [&]() {
+        queue.TryPush(snapshots[1]);
+        queue.TryPop(popped);
+    });
+
+    SCREEN *screen = OpenBenchTerminal();
+    if (!screen) {
+        fprintf(stderr, "bench: no terminal description, skipping Spectator\n");
+        return;
+    }
+    resizeterm(100, 200);
+
+    {
+        SpectatorView view(kGames, 30);
+        int           frame = 0;
+        runner.Run("Spectator/frame-64", 1, [&]() {
+            BoardSnapshot &snapshot = snapshots[++frame & 1];
+            for (int game = 0; game < kGames; ++game) {
+                snapshot.game = game;
+                view.GetQueue().TryPush(snapshot);
+            }
+            view.Frame();
+        });
+    }
+
+    endwin();
+    delscreen(screen);
+}
+
+static void BenchStats(BenchRunner &runner)
+{
+    runner.Run("ChessStats/Increment", 10000, []() {
+        ChessStats::Increment(ChessStats::MovesValidated);
+    });
+
+    runner.Run("ChessStats/ScopedTimer", 10000, []() {
+        ScopedStatsTimer timer(ChessStats::FrameRender);
+    });
+}
+
+static const char *kKiwipete =
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1";
+
+static void BenchMoveGeneration(BenchRunner &runner)
+{
+    ChessPosition position;
+    ChessMoveList moves;
+    position.SetFromFen(kKiwipete);
+
+    runner.Run("MoveGen/pseudo-legal", 1000, [&]() {
+        position.GeneratePseudoLegalMoves(moves);
+        gSink = moves.Size();
+    });
+
+    runner.Run("MoveGen/legal", 1000, [&]() {
+        position.GenerateLegalMoves(moves);
+        gSink = moves.Size();
+    });
+
+    // What a cut node pays before its first move can be searched: a hash
+    // move costs a pseudo-legality check, otherwise the captures are
+    // generated. "all" takes every legal move from the picker.
+    ChessMove hash_move = position.ParseMove("e2a6");
+    runner.Run("MovePicker/hash-move", 1000, [&]() {
+        MovePicker picker(position, hash_move, nullptr);
+        gSink = picker.Next().ToRaw();
+    });
+    runner.Run("MovePicker/first-capture", 1000, [&]() {
+        MovePicker picker(position, ChessMove(), nullptr);
+        gSink = picker.Next().ToRaw();
+    });
+    runner.Run("MovePicker/all", 1000, [&]() {
+        MovePicker picker(position, hash_move, nullptr);
+        int        count = 0;
+        while (!picker.Next().IsNull())
+            ++count;
+        gSink = count;
+    });
+
+    runner.Run("Perft/start-d3", 1, [&]() {
+        ChessPosition start;
+        gSink = start.Perft(3);
+    });
+
+    runner.Run("Perft/kiwipete-d2", 1, [&]() { gSink = position.Perft(2); });
+}
+
+static void BenchEvaluate(BenchRunner &runner)
+{
+    ChessPosition position;
+    position.SetFromFen(kKiwipete);
+
+    runner.Run("Evaluate/classical", 1000,
+               [&]() { gSink = Evaluate(position); });
+
+    // The network reproduces the classical terms, so both evaluations do
+    // comparable work for the search; only their cost differs.
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/chess-bench-%d.nnue", getpid());
+
+    NnueNetwork network;
+    bool        loaded =
+        NnueNetwork::WriteFromClassical(path) && network.Load(path);
+    unlink(path);
+    if (!loaded) {
+        fprintf(stderr, "bench: cannot create %s\n", path);
+        return;
+    }
+
+    ChessPosition nnue_position;
+    nnue_position.SetFromFen(kKiwipete);
+    nnue_position.SetNetwork(&network);
+
+    runner.Run("Evaluate/nnue", 1000,
+               [&]() { gSink = Evaluate(nnue_position); });
+    network.SetAvx2(false);
+    runner.Run("Evaluate/nnue-scalar", 1000,
+               [&]() { gSink = Evaluate(nnue_position); });
+    network.SetAvx2(true);
+
+    // Incremental accumulator upkeep, against make/unmake without it.
+    ChessMoveList moves;
+    position.GenerateLegalMoves(moves);
+    int next = 0;
+    runner.Run("MakeUnmake/classical", moves.Size(), [&]() {
+        const ChessMove &move = moves[next++ % moves.Size()];
+        position.MakeMove(move);
+        position.UnmakeMove(move);
+    });
+    next = 0;
+    runner.Run("MakeUnmake/nnue", moves.Size(), [&]() {
+        const ChessMove &move = moves[next++ % moves.Size()];
+        nnue_position.MakeMove(move);
+        nnue_position.UnmakeMove(move);
+    });
+
+    runner.Run("Evaluate/nnue-refresh", 1000, [&]() {
+        nnue_position.SetNetwork(&network);
+        gSink = Evaluate(nnue_position);
+    });
+
+    ChessSearch  search;
+    SearchLimits limits;
+    limits.depth = 5;
+    runner.Run("Search/kiwipete-d5/nnue", 1, [&]() {
+        gSink = search.Search(nnue_position, limits).nodes;
+    });
+}
+
+static void BenchSearch(BenchRunner &runner)
+{
+    ChessPosition position;
+    ChessSearch   search;
+    SearchLimits  limits;
+    position.SetFromFen(kKiwipete);
+    limits.depth = 4;
+
+    runner.Run("Search/kiwipete-d4", 1, [&]() {
+        gSink = search.Search(position, limits).nodes;
+    });
+
+    // Time to depth 5 with everything on, all off, and each technique off
+    // on its own.
+    static const char *const kVariants[] = {
+        "",         "all", "pvs",      "aspiration",
+        "null-move", "lmr", "futility",
+    };
+
+    limits.depth = 5;
+    for (const char *variant : kVariants) {
+        SearchOptions options;
+        std::string   name = "Search/kiwipete-d5";
+        if (*variant) {
+            options.Disable(variant);
+            name = name + "/no-" + variant;
+        }
+
+        search.SetOptions(options);
+        runner.Run(name.c_str(), 1, [&]() {
+            gSink = search.Search(position, limits).nodes;
+        });
+    }
+    search.SetOptions(SearchOptions());
+
+    // Starts from an empty table every time so the reps stay comparable.
+    TranspositionTable table;
+    table.Resize(16);
+    search.SetTable(&table);
+    runner.Run("Search/kiwipete-d5/tt", 1, [&]() {
+        table.Clear();
+        gSink = search.Search(position, limits).nodes;
+    });
+    search.SetTable(nullptr);
+}
+
+// Keys come from a fixed xorshift sequence, spread over a table much
+// larger than the caches like the keys of a real search. There are too
+// many of them to stay cached between repetitions.
+static void BenchTable(BenchRunner &runner)
+{
+    static const int kKeys = 1 << 20;
+
+    TranspositionTable    table;
+    TableEntry            entry;
+    std::vector<uint64_t> keys(kKeys);
+    uint64_t              x = 0x9e3779b97f4a7c15ull;
+    for (uint64_t &key : keys) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        key = x;
+    }
+
+    table.Resize(256);
+    for (int i = 0; i < kKeys; i += 2)
+        table.Store(keys[i], ChessMove(), i & 1023, 4, TableEntry::Exact);
+
+    int next = 0;
+    runner.Run("TT/store", 4096, [&]() {
+        next = (next + 1) & (kKeys - 1);
+        table.Store(keys[next], ChessMove(), next & 1023, 4,
+                    TableEntry::Exact);
+    });
+    runner.Run("TT/probe", 4096, [&]() {
+        next = (next + 1) & (kKeys - 1);
+        gSink = table.Probe(keys[next], entry);
+    });
+    // Prefetching a few keys ahead, as the search does for its children.
+    runner.Run("TT/probe-prefetched", 4096, [&]() {
+        next = (next + 1) & (kKeys - 1);
+        table.Prefetch(keys[(next + 8) & (kKeys - 1)]);
+        gSink = table.Probe(keys[next], entry);
+    });
+    runner.Run("TT/clear-256mb", 1, [&]() { table.Clear(); });
+    runner.Run("TT/resize-64mb", 1, [&]() { table.Resize(64); });
+}
+
+// A million plies of knights going back and forth, the longest game the
+// history is meant for; none of them reaches e4 or moves a pawn, so the
+// scans walk all of it.
+static void BenchHistory(BenchRunner &runner)
+{
+    static const int kMoves = 1 << 20;
+
+    const char   *shuffle[] = {"g1f3", "g8f6", "f3g1", "f6g8"};
+    ChessMove     moves[4];
+    ChessPosition position;
+    MoveHistory   history;
+
+    position.SetFromFen(ChessPosition::kStartFen);
+    for (int i = 0; i < 4; ++i) {
+        moves[i] = position.ParseMove(shuffle[i]);
+        position.MakeMove(moves[i]);
+    }
+
+    runner.Run("History/push-1m", 1, [&]() {
+        history.Clear();
+        for (int i = 0; i < kMoves; ++i)
+            history.Push(moves[i & 3]);
+        gSink = history.Size();
+    });
+    runner.Run("History/was-reached-1m", 1, [&]() {
+        gSink = history.WasReached(SquareIndex(4, 4));
+    });
+    runner.Run("History/halfmove-clock-1m", 1,
+               [&]() { gSink = history.HalfmoveClock(); });
+
+    FILE *null = fopen("/dev/null", "w");
+    if (!null)
+        return;
+    runner.Run("History/pgn-1m", 1, [&]() { gSink = history.WritePgn(null); });
+    fclose(null);
+}
+
+// Proofs start from an empty table every rep. Disproving mate in 2 in
+// kiwipete has to refute every attacking line, which is the common case
+// when checking puzzles.
+static void BenchMate(BenchRunner &runner)
+{
+    ChessPosition position;
+    MateSolver    solver;
+    MateLimits    limits;
+    solver.Resize(16);
+
+    position.SetFromFen(
+        "3q1rk1/p4pp1/2pb3p/3p4/6Pr/1PNQ4/P1PB1PP1/4RRK1 b - - 0 1");
+    limits.moves = 5;
+    runner.Run("Mate/wac009-mate-in-5", 1, [&]() {
+        solver.Clear();
+        gSink = solver.Solve(position, limits).moves;
+    });
+
+    position.SetFromFen(kKiwipete);
+    limits.moves = 2;
+    runner.Run("Mate/kiwipete-no-mate-in-2", 1, [&]() {
+        solver.Clear();
+        gSink = solver.Solve(position, limits).outcome;
+    });
+}
+
+// Warm start from a saved table: loading only maps the file, and the first
+// probes into each 64 KB block pay for checking it.
+static void BenchCacheFile(BenchRunner &runner)
+{
+    static const int      kKeys        = 1 << 20;
+    static const uint64_t kFingerprint = 1;
+
+    TranspositionTable    table;
+    EvalCache             eval_cache;
+    TableEntry            entry;
+    std::vector<uint64_t> keys(kKeys);
+    uint64_t              x = 0x9e3779b97f4a7c15ull;
+    for (uint64_t &key : keys) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        key = x;
+    }
+
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/chess-bench-%d.tt", getpid());
+
+    table.Resize(64);
+    for (int i = 0; i < kKeys; ++i)
+        table.Store(keys[i], ChessMove(), i & 1023, 4, TableEntry::Exact);
+    if (!table.Save(path, kFingerprint)) {
+        fprintf(stderr, "bench: cannot create %s\n", path);
+        return;
+    }
+
+    runner.Run("Cache/save-tt-64mb", 1,
+               [&]() { gSink = table.Save(path, kFingerprint); });
+    runner.Run("Cache/load-tt-64mb", 1,
+               [&]() { gSink = table.Load(path, kFingerprint); });
+    // Reloaded every rep, so each rep starts with every block unchecked.
+    runner.Run("Cache/load-probe-all-tt-64mb", 1, [&]() {
+        table.Load(path, kFingerprint);
+        for (int i = 0; i < kKeys; ++i)
+            gSink = table.Probe(keys[i], entry);
+    });
+    unlink(path);
+
+    int next = 0;
+    runner.Run("Cache/probe-mapped-tt", 4096, [&]() {
+        next = (next + 1) & (kKeys - 1);
+        gSink = table.Probe(keys[next], entry);
+    });
+
+    int score;
+    eval_cache.Resize(16);
+    for (int i = 0; i < kKeys; i += 2)
+        eval_cache.Store(keys[i], i & 1023);
+    runner.Run("Cache/eval-probe", 4096, [&]() {
+        next = (next + 1) & (kKeys - 1);
+        gSink = eval_cache.Probe(keys[next], score);
+    });
+}
+
+static bool SendLine(int fd, const char *line)
+{
+    size_t len = strlen(line);
+    return write(fd, line, len) == static_cast<ssize_t>(len);
+}
+
+static bool ReadLine(int fd, char *buf, size_t size)
+{
+    size_t len = 0;
+    while (len + 1 < size && read(fd, buf + len, 1) == 1) {
+        if (buf[len] == '\n') {
+            buf[len] = '\0';
+            return true;
+        }
+        ++len;
+    }
+    return false;
+}
+
+// Round trips through a live server: every op sends one move on each
+// connection and waits for all the acknowledgements, so the server sees
+// kConnections requests in flight at once.
+static void BenchServer(BenchRunner &runner)
+{
+    const int   kConnections = 64;
+    const char *kMoves[]     = {"g1f3", "g8f6", "f3g1", "f6g8"};
+
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/chess-bench-%d.sock", getpid());
+
+    ChessServer server;
+    if (!server.Listen(path)) {
+        perror(path);
+        return;
+    }
+    std::thread server_thread(&ChessServer::Run, &server);
+
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+
+    int  fds[kConnections];
+    char games[kConnections][32];
+    char line[128];
+    bool ready = true;
+
+    for (int i = 0; i < kConnections; ++i) {
+        fds[i] = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (connect(fds[i], reinterpret_cast<sockaddr *>(&addr),
+                    sizeof(addr)) < 0 ||
+            !SendLine(fds[i], "new\n") || !ReadLine(fds[i], line, 128) ||
+            sscanf(line, "ok %31s", games[i]) != 1) {
+            ready = false;
+        }
+    }
+
+    if (ready) {
+        int ply = 0, conn = 0;
+        runner.Run("Server/move-ack", kConnections, [&]() {
+            snprintf(line, sizeof(line), "move %s %s\n", games[conn],
+                     kMoves[ply % 4]);
+            SendLine(fds[conn], line);
+            if (++conn == kConnections) {
+                for (int i = 0; i < kConnections; ++i)
+                    ReadLine(fds[i], line, sizeof(line));
+                conn = 0;
+                ++ply;
+            }
+        });
+    } else {
+        fprintf(stderr, "bench: server setup failed, skipping Server\n");
+    }
+
+    for (int i = 0; i < kConnections; ++i)
+        close(fds[i]);
+    server.Stop();
+    server_thread.join();
+    unlink(path);
+}
+
+static void PrintUsage()
+{
+    fprintf(stderr,
+            "usage: bench [--warmup N] [--reps N] [--filter SUBSTR] "
+            "[--json FILE]\n");
+}
+
+int main(int argc, char **argv)
+{
+    int         warmup      = 10;
+    int         repetitions = 100;
+    const char *filter      = nullptr;
+    const char *json_path   = nullptr;
+
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--warmup") && i + 1 < argc) {
+            warmup = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--reps") && i + 1 < argc) {
+            repetitions = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--filter") && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (!strcmp(argv[i], "--json") && i + 1 < argc) {
+            json_path = argv[++i];
+        } else {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    if (warmup < 0 || repetitions < 1) {
+        PrintUsage();
+        return 1;
+    }
+
+    BenchRunner runner(warmup, repetitions, filter);
+
+    BenchMovePiece(runner);
+    BenchCanMovePiece(runner);
+    BenchCheckForCheckMate(runner);
+    BenchDrawBoard(runner);
+    BenchSpectator(runner);
+    BenchStats(runner);
+    BenchMoveGeneration(runner);
+    BenchEvaluate(runner);
+    BenchSearch(runner);
+    BenchTable(runner);
+    BenchCacheFile(runner);
+    BenchMate(runner);
+    BenchHistory(runner);
+    BenchServer(runner);
+
+    runner.PrintTable(stdout);
+
+    if (json_path) {
+        FILE *out = !strcmp(json_path, "-") ? stdout : fopen(json_path, "w");
+        if (!out) {
+            perror(json_path);
+            return 1;
+        }
+        runner.PrintJson(out);
+        if (out != stdout)
+            fclose(out);
+    }
+
+    return 0;
+}
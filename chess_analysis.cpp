@@ -0,0 +1,178 @@
+#include "chess_analysis.h"
+#include "chess_eval.h"
+#include "chess_thread_pool.h"
+
+#include <condition_variable>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+bool AnalyzePosition(const char *fen, ChessPosition &position,
+                     ChessSearch &search, const SearchLimits &limits,
+                     AnalysisResult &result)
+{
+    result = AnalysisResult();
+    if (!position.SetFromFen(fen))
+        return false;
+
+    ChessMoveList moves;
+    position.GenerateLegalMoves(moves);
+
+    SearchResult search_result = search.Search(position, limits);
+
+    result.valid       = true;
+    result.best_move   = search_result.best_move;
+    result.score       = search_result.score;
+    result.legal_moves = moves.Size();
+    result.nodes       = search_result.nodes;
+    result.hashfull    = search_result.hashfull;
+    return true;
+}
+
+BatchAnalyzer::BatchAnalyzer(const AnalysisOptions &options)
+    : options(options)
+{
+    if (this->options.threads < 1)
+        this->options.threads = WorkStealingPool::DefaultThreads();
+    if (this->options.window < 1)
+        this->options.window = this->options.threads * 8;
+}
+
+struct ReorderSlot {
+    std::string    fen;
+    AnalysisResult result;
+    bool           ready = false;
+};
+
+uint64_t BatchAnalyzer::Run(const Source &source, const Sink &sink)
+{
+    const uint64_t window = options.window;
+
+    std::vector<ReorderSlot> slots(window);
+    std::mutex               mutex;
+    std::condition_variable  done;
+
+    // Engine state is per worker and reused for every position it takes;
+    // the caches are shared, so workers profit from each other's results.
+    // Without memory for them the search still works, only slower.
+    const uint64_t     fingerprint = EvaluationFingerprint(options.network);
+    const std::string  table_path  = options.cache_path + ".tt";
+    const std::string  eval_path   = options.cache_path + ".eval";
+    const bool         persist     = !options.cache_path.empty();
+    TranspositionTable table;
+    EvalCache          eval_cache;
+
+    bool use_table = options.hash_mb &&
+                     ((persist && table.Load(table_path.c_str(), fingerprint)) ||
+                      table.Resize(options.hash_mb));
+    bool use_eval_cache =
+        options.eval_cache_mb &&
+        ((persist && eval_cache.Load(eval_path.c_str(), fingerprint)) ||
+         eval_cache.Resize(options.eval_cache_mb));
+
+    std::vector<std::unique_ptr<ChessPosition>> positions;
+    std::vector<std::unique_ptr<ChessSearch>>   searches;
+    for (int i = 0; i < options.threads; ++i) {
+        positions.emplace_back(new ChessPosition);
+        positions.back()->SetNetwork(options.network);
+        searches.emplace_back(new ChessSearch);
+        searches.back()->SetOptions(options.search);
+        if (use_table)
+            searches.back()->SetTable(&table);
+        if (use_eval_cache)
+            searches.back()->SetEvalCache(&eval_cache);
+    }
+
+    uint64_t submitted = 0, emitted = 0;
+
+    // Emits finished slots in order; with `block` set waits for the oldest.
+    auto drain = [&](bool block) {
+        while (emitted < submitted) {
+            ReorderSlot &slot = slots[emitted % window];
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                if (!slot.ready && !block)
+                    return;
+                done.wait(lock, [&]() { return slot.ready; });
+            }
+            sink(emitted, slot.fen, slot.result);
+            slot.ready = false;
+            ++emitted;
+            block = false;
+        }
+    };
+
+    {
+        WorkStealingPool pool(options.threads);
+        std::string      fen;
+
+        while (source(fen)) {
+            while (submitted - emitted >= window)
+                drain(true);
+
+            ReorderSlot *slot = &slots[submitted % window];
+            slot->fen.swap(fen);
+
+            pool.Submit([&, slot](int worker) {
+                AnalysisResult result;
+                AnalyzePosition(slot->fen.c_str(), *positions[worker],
+                                *searches[worker], options.limits, result);
+
+                std::lock_guard<std::mutex> lock(mutex);
+                slot->result = result;
+                slot->ready  = true;
+                done.notify_all();
+            });
+            ++submitted;
+
+            drain(false);
+        }
+
+        while (emitted < submitted)
+            drain(true);
+    }
+
+    // A cache that fails to save only costs the next run its warm start.
+    if (persist && use_table)
+        table.Save(table_path.c_str(), fingerprint);
+    if (persist && use_eval_cache)
+        eval_cache.Save(eval_path.c_str(), fingerprint);
+
+    return submitted;
+}
+
+uint64_t BatchAnalyzer::Run(FILE *in, FILE *out)
+{
+    char line[512];
+
+    auto source = [&](std::string &fen) {
+        while (fgets(line, sizeof(line), in)) {
+            line[strcspn(line, "\r\n")] = '\0';
+            if (line[strspn(line, " \t")]) {
+                fen = line;
+                return true;
+            }
+        }
+        return false;
+    };
+
+    auto sink = [&](uint64_t, const std::string &fen,
+                    const AnalysisResult &result) {
+        char score[32];
+        if (!result.valid) {
+            fprintf(out, "%s; error invalid fen\n", fen.c_str());
+            return;
+        }
+        FormatScore(result.score, score, sizeof(score));
+        fprintf(out, "%s; bm %s; score %s; legal %d; nodes %llu",
+                fen.c_str(), result.best_move.ToString().c_str(), score,
+                result.legal_moves,
+                static_cast<unsigned long long>(result.nodes));
+        if (options.hash_mb)
+            fprintf(out, "; hashfull %d", result.hashfull);
+        fputc('\n', out);
+    };
+
+    return Run(source, sink);
+}
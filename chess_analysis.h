@@ -0,0 +1,64 @@
+#ifndef CHESS_ANALYSIS_H
+#define CHESS_ANALYSIS_H
+
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+
+#include "chess_position.h"
+#include "chess_search.h"
+
+struct AnalysisResult {
+    bool      valid       = false;
+    ChessMove best_move;
+    int       score       = 0;
+    int       legal_moves = 0;
+    uint64_t  nodes       = 0;
+    int       hashfull    = 0;
+};
+
+struct AnalysisOptions {
+    int           threads       = 0;  // 0 means one per core
+    int           window        = 0;  // positions in flight, 0: 8 per thread
+    size_t        hash_mb       = 16; // table shared by all workers, 0: none
+    size_t        eval_cache_mb = 4;  // shared evaluation cache, 0: none
+    SearchLimits  limits;
+    SearchOptions search;
+    // Evaluates with this network instead of the classical evaluation.
+    const NnueNetwork *network = nullptr;
+    // Loads the table and evaluation cache from <cache_path>.tt and .eval
+    // when they were saved under the same evaluation, and saves them back
+    // once the run is done. Loaded caches keep the size they were saved
+    // with.
+    std::string cache_path;
+};
+
+// Analyzes one position using the caller's engine state.
+bool AnalyzePosition(const char *fen, ChessPosition &position,
+                     ChessSearch &search, const SearchLimits &limits,
+                     AnalysisResult &result);
+
+// Analyzes a stream of positions on a work-stealing thread pool. Results
+// come back strictly in input order through a bounded reorder buffer, so
+// memory use depends on the window size, not on the length of the input.
+class BatchAnalyzer {
+public:
+    // Fills `fen` with the next position; false at the end of input.
+    typedef std::function<bool(std::string &fen)> Source;
+    typedef std::function<void(uint64_t index, const std::string &fen,
+                               const AnalysisResult &result)>
+        Sink;
+
+    BatchAnalyzer(const AnalysisOptions &options);
+
+    uint64_t Run(const Source &source, const Sink &sink);
+    // One FEN per line in, one "<fen>; bm ...; score ...; legal ...;
+    // nodes ...[; hashfull ...]" line out. Blank lines are skipped.
+    uint64_t Run(FILE *in, FILE *out);
+
+private:
+    AnalysisOptions options;
+};
+
+#endif
@@ -1,4 +1,6 @@
 #include "chess_board.h"
+#include "chess_stats.h"
+#include <cctype>
 #include <ncurses.h>
 
 #ifndef NDEBUG
@@ -6,6 +8,16 @@
 extern Log gLog;
 #endif
 
+bool ParseSquare(const char *str, int &x, int &y)
+{
+    if (str[0] < 'a' || str[0] > 'h' || str[1] < '1' || str[1] > '8')
+        return false;
+
+    x = str[0] - 'a';
+    y = '8' - str[1];
+    return true;
+}
+
 ChessBoard::ChessBoard()
 {
     board[0][0] = new RookPiece(TeamID::Black);
@@ -74,6 +86,8 @@ void ChessBoard::DrawBoardCell(int x, int y) const
 
 void ChessBoard::DrawBoard() const
 {
+    ScopedStatsTimer timer(ChessStats::FrameRender);
+
 #ifndef NDEBUG
     fprintf(gLog, "%s: Board -\n", __func__);
     for (int y = 0; y < kBoardSize; ++y) {
@@ -90,6 +104,63 @@ void ChessBoard::DrawBoard() const
             DrawBoardCell(x, y);
 }
 
+char ChessBoard::GetCellChar(int x, int y) const
+{
+    ChessPiece *piece = board[y][x];
+    if (!piece)
+        return '.';
+
+    char ch = kPieceChars[piece->GetPieceID()];
+    return piece->GetTeamID() == TeamID::White ? toupper(ch) : tolower(ch);
+}
+
+bool ChessBoard::ToPosition(TeamID side_to_move, const MoveHistory &history,
+                            int halfmove_clock, ChessPosition &position) const
+{
+    PieceCode squares[64];
+    for (int y = 0; y < kBoardSize; ++y) {
+        for (int x = 0; x < kBoardSize; ++x) {
+            ChessPiece *piece = board[y][x];
+            squares[SquareIndex(x, y)] =
+                piece ? MakePieceCode(piece->GetTeamID(), piece->GetPieceID())
+                      : kNoPiece;
+        }
+    }
+
+    // Pieces that moved lose their rights; ChessPosition drops the ones
+    // whose king or rook is not on its home square.
+    int castling = 0;
+    if (board[7][4] && !board[7][4]->HasMovedBefore()) {
+        if (board[7][7] && !board[7][7]->HasMovedBefore())
+            castling |= ChessPosition::WhiteKingSide;
+        if (board[7][0] && !board[7][0]->HasMovedBefore())
+            castling |= ChessPosition::WhiteQueenSide;
+    }
+    if (board[0][4] && !board[0][4]->HasMovedBefore()) {
+        if (board[0][7] && !board[0][7]->HasMovedBefore())
+            castling |= ChessPosition::BlackKingSide;
+        if (board[0][0] && !board[0][0]->HasMovedBefore())
+            castling |= ChessPosition::BlackQueenSide;
+    }
+
+    int ep_square = history.EnPassantSquare();
+
+    return position.Setup(squares, side_to_move, castling, ep_square,
+                          halfmove_clock);
+}
+
+void ChessBoard::InitColors()
+{
+    init_pair(1, COLOR_WHITE, COLOR_BLUE);
+    init_pair(2, COLOR_WHITE, COLOR_CYAN);
+    init_pair(3, COLOR_BLACK, COLOR_BLUE);
+    init_pair(4, COLOR_BLACK, COLOR_CYAN);
+    init_pair(5, COLOR_WHITE, COLOR_RED);
+    init_pair(6, COLOR_BLACK, COLOR_RED);
+    init_pair(7, COLOR_WHITE, COLOR_YELLOW);
+    init_pair(8, COLOR_BLACK, COLOR_YELLOW);
+}
+
 void ChessBoard::HighlightBoardCell(int x, int y) const
 {
     char ch;
@@ -129,201 +200,145 @@ void ChessBoard::DrawBoardBorder() const
     }
 }
 
-bool ChessBoard::MovePiece(TeamID team_id, int piece_x, int piece_y, int dest_x,
-                           int dest_y, TurnInfo &last_turn)
+// Scratch position for the one-shot checks below, so they do not have to
+// allocate the position's history on every call.
+static ChessPosition &ScratchPosition()
 {
-    bool success = false;
+    thread_local ChessPosition position;
+    return position;
+}
 
-    if (AreCoordsCorrect(piece_x, piece_y) &&
-        AreCoordsCorrect(dest_x, dest_y) && board[piece_y][piece_x]
-        ) {
-        // board[piece_y][piece_x]->GetTeamID() == team_id
-
-        // Castling
-        if (board[dest_y][dest_x] &&
-            CheckForCastling(piece_x, piece_y, dest_x, dest_y) &&
-            CanDoCastling(piece_x, piece_y, dest_x, dest_y)) {
-            int         team_y, rook_x, king_x;
-            ChessPiece *king, *rook;
-
-            if (board[piece_y][piece_x]->GetPieceID() == ChessPiece::King) {
-                king   = board[piece_y][piece_x];
-                rook   = board[dest_y][dest_x];
-                rook_x = dest_x;
-                king_x = piece_x;
-            } else {
-                rook   = board[piece_y][piece_x];
-                king   = board[dest_y][dest_x];
-                rook_x = piece_x;
-                king_x = dest_x;
-            }
+ChessMove ChessBoard::MatchMove(const ChessMoveList &legal, int from, int to)
+{
+    // Promotions are generated queen first, so the first match auto-queens.
+    for (int i = 0; i < legal.Size(); ++i) {
+        const ChessMove &move = legal[i];
+        if (move.GetFrom() == from &&
+            (move.GetTo() == to || (move.GetFlag() == ChessMove::Castling &&
+                                    CastlingRookSquare(move) == to)))
+            return move;
+    }
+    return ChessMove();
+}
 
-            if (team_id == TeamID::White)
-                team_y = 7;
-            else
-                team_y = 0;
-
-            if (rook_x > king_x) {
-                board[team_y][6] = king;
-                board[team_y][5] = rook;
-            } else {
-                board[team_y][1] = king;
-                board[team_y][2] = rook;
-            }
-            board[piece_y][piece_x] = nullptr;
-            board[dest_y][dest_x]   = nullptr;
+void ChessBoard::ApplyMove(const ChessMove &move, MoveHistory &history)
+{
+    int from_x = SquareX(move.GetFrom()), from_y = SquareY(move.GetFrom());
+    int to_x = SquareX(move.GetTo()), to_y = SquareY(move.GetTo());
 
-            success = true;
-            // Simple movement
-        } else if (board[piece_y][piece_x]->CanMovePiece(
-                       piece_x, piece_y, dest_x, dest_y, board, last_turn)) {
-            last_turn.ChangeTurnInfo(piece_x, piece_y, dest_x, dest_y,
-                                     board[piece_y][piece_x]);
+    ChessPiece *piece = board[from_y][from_x];
 
-            board[dest_y][dest_x]   = board[piece_y][piece_x];
-            board[piece_y][piece_x] = nullptr;
+    if (move.GetFlag() == ChessMove::EnPassant) {
+        delete board[from_y][to_x];
+        board[from_y][to_x] = nullptr;
+    } else if (move.GetFlag() == ChessMove::Castling) {
+        int rook_x = SquareX(CastlingRookSquare(move));
+        int rook_to_x = to_x > from_x ? to_x - 1 : to_x + 1;
 
-            success = true;
-        }
+        board[from_y][rook_to_x] = board[from_y][rook_x];
+        board[from_y][rook_x]    = nullptr;
+        board[from_y][rook_to_x]->MarkMoved();
     }
 
-    return success;
+    delete board[to_y][to_x];
+    board[to_y][to_x]     = piece;
+    board[from_y][from_x] = nullptr;
+    piece->MarkMoved();
+
+    if (move.GetPromotion()) {
+        delete piece;
+        piece = ChessPiece::Create(PieceCodeID(move.GetPromotion()),
+                                   PieceCodeTeam(move.GetPromotion()));
+        piece->MarkMoved();
+        board[to_y][to_x] = piece;
+    }
+
+    history.Push(move);
 }
 
-bool ChessBoard::CheckForCastling(int first_x, int first_y, int secnd_x,
-                                  int secnd_y)
+bool ChessBoard::UndoMove(MoveHistory &history)
 {
-    bool have_not_moved = !board[secnd_y][secnd_x]->HasMovedBefore() &&
-                          !board[secnd_y][secnd_x]->HasMovedBefore();
-
-    bool king_and_rook =
-        (board[first_y][first_x]->GetPieceID() == ChessPiece::King &&
-         board[secnd_y][secnd_x]->GetPieceID() == ChessPiece::Rook) ||
-        (board[first_y][first_x]->GetPieceID() == ChessPiece::Rook &&
-         board[secnd_y][secnd_x]->GetPieceID() == ChessPiece::King);
-
-    bool have_same_team = board[secnd_y][secnd_x]->GetTeamID() ==
-                          board[first_y][first_x]->GetTeamID();
-
-    return have_not_moved && king_and_rook && have_same_team;
+    ChessMove move = history.Pop();
+    if (move.IsNull())
+        return false;
+
+    int from_x = SquareX(move.GetFrom()), from_y = SquareY(move.GetFrom());
+    int to_x = SquareX(move.GetTo()), to_y = SquareY(move.GetTo());
+
+    ChessPiece *piece = board[to_y][to_x];
+    if (move.GetPromotion()) {
+        delete piece;
+        piece = ChessPiece::Create(PieceCodeID(move.GetPiece()),
+                                   PieceCodeTeam(move.GetPiece()));
+    }
+    board[from_y][from_x] = piece;
+    board[to_y][to_x]     = nullptr;
+    // With the move gone, the history tells whether the piece had moved.
+    piece->SetMoved(history.WasReached(move.GetFrom()));
+
+    if (move.GetFlag() == ChessMove::EnPassant) {
+        board[from_y][to_x] = ChessPiece::Create(
+            ChessPiece::Pawn, PieceCodeTeam(move.GetCaptured()));
+        board[from_y][to_x]->MarkMoved();
+    } else if (move.IsCapture()) {
+        board[to_y][to_x] = ChessPiece::Create(
+            PieceCodeID(move.GetCaptured()), PieceCodeTeam(move.GetCaptured()));
+        board[to_y][to_x]->SetMoved(history.WasReached(move.GetTo()));
+    } else if (move.GetFlag() == ChessMove::Castling) {
+        int rook_x    = SquareX(CastlingRookSquare(move));
+        int rook_to_x = to_x > from_x ? to_x - 1 : to_x + 1;
+
+        board[from_y][rook_x]    = board[from_y][rook_to_x];
+        board[from_y][rook_to_x] = nullptr;
+        board[from_y][rook_x]->SetMoved(false);
+    }
+    return true;
 }
 
-bool ChessBoard::CanDoCastling(int first_x, int first_y, int secnd_x,
-                               int secnd_y)
+bool ChessBoard::MovePiece(TeamID team_id, int piece_x, int piece_y, int dest_x,
+                           int dest_y, MoveHistory &history)
 {
-    bool success = true;
-    int  from    = first_x > secnd_x ? secnd_x : secnd_x;
-    int  to      = from == first_x ? secnd_x : first_x;
-
-    for (int x = from + 1; x < to; ++x) {
-        if (board[first_y][x]) {
-            success = false;
-            break;
+    bool success = false;
+
+    if (AreCoordsCorrect(piece_x, piece_y) &&
+        AreCoordsCorrect(dest_x, dest_y) && board[piece_y][piece_x] &&
+        board[piece_y][piece_x]->GetTeamID() == team_id) {
+        ChessPosition &position = ScratchPosition();
+        ChessMoveList  legal;
+
+        if (ToPosition(team_id, history, 0, position)) {
+            position.GenerateLegalMoves(legal);
+
+            ChessMove move = MatchMove(legal, SquareIndex(piece_x, piece_y),
+                                       SquareIndex(dest_x, dest_y));
+            if (!move.IsNull()) {
+                ApplyMove(move, history);
+                success = true;
+            }
         }
     }
 
+    ChessStats::Increment(success ? ChessStats::MovesValidated
+                                  : ChessStats::MovesRejected);
     return success;
 }
 
-// UNDER DEVELOPEMENT
-bool ChessBoard::CheckForCheckMate(TeamID team_id)
+bool ChessBoard::CheckForCheckMate(TeamID team_id, const MoveHistory &history)
 {
-    bool checkmate        = false;
-    // INCORRECT
-    int  checkmate_checks = 0;
-
-    int  king_x = -1, king_y = -1;
-    bool king_finded = false;
-
-    for (int y = 0; y < 8; ++y) {
-        for (int x = 0; x < 8; ++x) {
-            if (board[y][x] && board[y][x]->GetTeamID() == team_id &&
-                board[y][x]->GetPieceID() == ChessPiece::King) {
-                king_x      = x;
-                king_y      = y;
-                king_finded = true;
-                break;
-            }
-        }
-        if (king_finded)
-            break;
-    }
+    ScopedStatsTimer timer(ChessStats::CheckMateTime);
 
-    TurnInfo    temp;
-    ChessPiece *king      = board[king_y][king_x];
-    board[king_y][king_x] = nullptr;
-
-    for (int y = 0; y < 8; ++y) {
-        for (int x = 0; x < 8; ++x) {
-            if (board[y][x] && board[y][x]->GetTeamID() != team_id) {
-                if (board[y][x]->GetPieceID() == ChessPiece::Pawn)
-                    board[king_y][king_x] = king;
-
-                if (board[y][x]->CanMovePiece(x, y, king_x, king_y, board,
-                                              temp))
-                    ++checkmate_checks; // INCORRECT
-
-                if (king_y - 1 >= 0 && !board[king_y - 1][king_x] &&
-                    board[y][x]->CanMovePiece(x, y, king_x, king_y - 1, board,
-                                              temp))
-                    ++checkmate_checks; // INCORRECT
-
-                if (king_y + 1 <= 7 && !board[king_y + 1][king_x] &&
-                    board[y][x]->CanMovePiece(x, y, king_x, king_y + 1, board,
-                                              temp))
-                    ++checkmate_checks; // INCORRECT
-
-                if (king_x - 1 >= 0) {
-                    if (!board[king_y][king_x - 1] &&
-                        board[y][x]->CanMovePiece(x, y, king_x - 1, king_y,
-                                                  board, temp))
-                        ++checkmate_checks; // INCORRECT
-
-                    if (king_y - 1 >= 0 && !board[king_y - 1][king_x - 1] &&
-                        board[y][x]->CanMovePiece(x, y, king_x - 1, king_y - 1,
-                                                  board, temp))
-                        ++checkmate_checks; // INCORRECT
-
-                    if (king_y + 1 <= 7 && !board[king_y - 1][king_x + 1] &&
-                        board[y][x]->CanMovePiece(x, y, king_x - 1, king_y + 1,
-                                                  board, temp))
-                        ++checkmate_checks; // INCORRECT
-
-                }
-
-                if (king_x + 1 <= 7) {
-                    if (!board[king_y][king_x + 1] &&
-                        board[y][x]->CanMovePiece(x, y, king_x + 1, king_y,
-                                                  board, temp))
-                        ++checkmate_checks; // INCORRECT
-
-                    if (king_y - 1 >= 0 && !board[king_y - 1][king_x + 1] &&
-                        board[y][x]->CanMovePiece(x, y, king_x + 1, king_y - 1,
-                                                  board, temp))
-                        ++checkmate_checks; // INCORRECT
-
-                    if (king_y + 1 <= 7 && !board[king_y + 1][king_x + 1] &&
-                        board[y][x]->CanMovePiece(x, y, king_x + 1, king_y + 1,
-                                                  board, temp))
-                        ++checkmate_checks; // INCORRECT
-                }
-
-                if (board[y][x]->GetPieceID() == ChessPiece::Pawn)
-                    board[king_y][king_x] = nullptr;
-            }
-        }
-    }
+    ChessPosition &position = ScratchPosition();
+    ChessMoveList  legal;
 
-    board[king_y][king_x] = king;
+    if (!ToPosition(team_id, history, 0, position))
+        return false;
 
-    // INCORRECT!!!!!!
-    if (checkmate_checks >= 9)
-        checkmate = true;
+    position.GenerateLegalMoves(legal);
+    bool checkmate = legal.Size() == 0 && position.IsInCheck();
 
 #ifndef NDEBUG
-    fprintf(gLog, "%s: %d\n", __func__, checkmate_checks);
+    fprintf(gLog, "%s: %d\n", __func__, checkmate);
     fflush(gLog);
 #endif
     return checkmate;
 }
-
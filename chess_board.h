@@ -1,14 +1,18 @@
 #ifndef CHESS_BOARD_H
 #define CHESS_BOARD_H
 
+#include "chess_history.h"
 #include "chess_pieces.h"
+#include "chess_position.h"
 #include <ncurses.h>
 
 class ChessPiece;
-class LastTurn;
 
 const int kBoardSize = 8;
 
+// Parses algebraic square names like "e2" into board coordinates.
+bool ParseSquare(const char *str, int &x, int &y);
+
 class ChessBoard {
 public:
     ChessPiece *board[8][8];
@@ -16,24 +20,45 @@ public:
     ChessBoard();
     ~ChessBoard();
 
+    // Validates against the engine's legal moves; a king moved onto its own
+    // rook castles towards it and pawns promote to a queen. Played moves
+    // are appended to `history`.
     bool MovePiece(TeamID team_id, int piece_x, int piece_y, int dest_x,
-                   int dest_y, TurnInfo &last_turn);
+                   int dest_y, MoveHistory &history);
+
+    // Plays a move taken from a legal move list of this placement.
+    void ApplyMove(const ChessMove &move, MoveHistory &history);
+    // Takes back the last move of `history`, which must be the moves
+    // played on this board; false when there is none.
+    bool UndoMove(MoveHistory &history);
+    // Finds the legal move for a from/to pair as MovePiece interprets it;
+    // a null move when there is none.
+    static ChessMove MatchMove(const ChessMoveList &legal, int from, int to);
+
+    // Sets up the color pairs the drawing code and ChessPiece refer to by
+    // number. Needs start_color() to have been called.
+    static void InitColors();
 
     void HighlightBoardCell(int x, int y) const;
     void DrawBoardCell(int x, int y) const;
     void DrawBoard() const;
     void DrawBoardBorder() const;
 
-    bool CheckForCheckMate(TeamID team_id);
+    bool CheckForCheckMate(TeamID team_id, const MoveHistory &history);
+
+    // Copies the placement into an engine position; castling rights come
+    // from has_moved_before and the en passant square from the last move.
+    bool ToPosition(TeamID side_to_move, const MoveHistory &history,
+                    int halfmove_clock, ChessPosition &position) const;
+
+    // '.' for an empty cell, upper case for white pieces, lower for black.
+    char GetCellChar(int x, int y) const;
 
     bool IsCellEmpty(int x, int y) const { return board[y][x] == nullptr; }
     bool AreCoordsCorrect(int x, int y) const
     {
         return x >= 0 && x <= 7 && y >= 0 && y <= 7;
     }
-private:
-    bool CheckForCastling(int first_x, int first_y, int secnd_x, int secnd_y);
-    bool CanDoCastling(int first_x, int first_y, int secnd_x, int secnd_y);
 };
 
 #endif
@@ -0,0 +1,235 @@
+#include "chess_cache_file.h"
+#include "chess_stats.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+const uint32_t kCacheFileVersion = 1;
+const size_t   kCachePageSize    = 4096;
+
+struct CacheFileHeader {
+    char     magic[4]; // "CHCF"
+    uint32_t version;
+    uint32_t kind;
+    uint32_t record_size;
+    uint64_t fingerprint;
+    uint64_t owner_value;
+    uint64_t data_size;
+    uint64_t block_count;
+    uint64_t checksum; // of the fields above and the block checksums
+    uint64_t reserved;
+};
+
+static_assert(sizeof(CacheFileHeader) == 64, "header must stay 64 bytes");
+
+uint64_t HashBytes(const void *data, size_t size, uint64_t seed)
+{
+    const unsigned char *p = static_cast<const unsigned char *>(data);
+    uint64_t             h = seed ^ (size * 0x9e3779b97f4a7c15ULL);
+
+    // Four independent lanes keep the multiplier busy.
+    uint64_t lanes[4] = {h, h + 1, h + 2, h + 3};
+    for (; size >= 32; size -= 32, p += 32) {
+        for (int i = 0; i < 4; ++i) {
+            uint64_t word;
+            memcpy(&word, p + i * 8, 8);
+            lanes[i] = (lanes[i] ^ word) * 0xff51afd7ed558ccdULL;
+            lanes[i] ^= lanes[i] >> 32;
+        }
+    }
+    for (int i = 0; i < 4; ++i)
+        h = (h ^ lanes[i]) * 0xc4ceb9fe1a85ec53ULL;
+    for (; size; --size, ++p)
+        h = (h ^ *p) * 0x100000001b3ULL;
+
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    return h ^ (h >> 33);
+}
+
+static size_t DataOffset(uint64_t block_count)
+{
+    size_t table = sizeof(CacheFileHeader) + block_count * sizeof(uint64_t);
+    return (table + kCachePageSize - 1) & ~(kCachePageSize - 1);
+}
+
+static uint64_t HeaderChecksum(const CacheFileHeader &header,
+                               const uint64_t *checksums)
+{
+    return HashBytes(checksums, header.block_count * sizeof(uint64_t),
+                     HashBytes(&header, offsetof(CacheFileHeader, checksum)));
+}
+
+CacheFile::~CacheFile()
+{
+    Close();
+}
+
+void CacheFile::Close()
+{
+    if (mapping)
+        munmap(mapping, mapping_size);
+    mapping      = nullptr;
+    mapping_size = 0;
+    data         = nullptr;
+    data_size    = 0;
+    checksums    = nullptr;
+    block_count  = 0;
+    states.reset();
+}
+
+void CacheFile::Swap(CacheFile &other)
+{
+    std::swap(mapping, other.mapping);
+    std::swap(mapping_size, other.mapping_size);
+    std::swap(data, other.data);
+    std::swap(data_size, other.data_size);
+    std::swap(owner_value, other.owner_value);
+    std::swap(checksums, other.checksums);
+    std::swap(states, other.states);
+    std::swap(block_count, other.block_count);
+}
+
+bool CacheFile::Open(const char *path, Kind kind, uint32_t record_size,
+                     uint64_t fingerprint)
+{
+    Close();
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    void       *file = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && size_t(st.st_size) >= sizeof(CacheFileHeader))
+        file = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                    fd, 0);
+    close(fd);
+    if (file == MAP_FAILED)
+        return false;
+
+    // Everything the header says is checked before any of it is trusted.
+    const CacheFileHeader *header = static_cast<CacheFileHeader *>(file);
+    const uint64_t        *table  = reinterpret_cast<const uint64_t *>(
+        static_cast<char *>(file) + sizeof(CacheFileHeader));
+    uint64_t blocks = (header->data_size + (1 << kBlockShift) - 1) >>
+                      kBlockShift;
+
+    bool valid =
+        !memcmp(header->magic, "CHCF", 4) &&
+        header->version == kCacheFileVersion && header->kind == kind &&
+        header->record_size == record_size &&
+        header->fingerprint == fingerprint && header->data_size &&
+        header->data_size < size_t(st.st_size) &&
+        header->block_count == blocks &&
+        DataOffset(blocks) + header->data_size == size_t(st.st_size) &&
+        header->checksum == HeaderChecksum(*header, table);
+    if (!valid) {
+        munmap(file, st.st_size);
+        return false;
+    }
+
+    mapping      = file;
+    mapping_size = st.st_size;
+    data         = static_cast<char *>(file) + DataOffset(blocks);
+    data_size    = header->data_size;
+    owner_value  = header->owner_value;
+    checksums    = table;
+    block_count  = blocks;
+    states.reset(new std::atomic<uint8_t>[blocks]);
+    for (size_t i = 0; i < blocks; ++i)
+        states[i].store(kUnchecked, std::memory_order_relaxed);
+    return true;
+}
+
+// The first thread to need a block checks it; others wait for the result
+// rather than read a block that may be about to be zeroed.
+void CacheFile::ValidateBlock(size_t block)
+{
+    uint8_t state = kUnchecked;
+    if (!states[block].compare_exchange_strong(state, kChecking,
+                                               std::memory_order_acquire)) {
+        while (states[block].load(std::memory_order_acquire) != kChecked)
+            std::this_thread::yield();
+        return;
+    }
+
+    size_t start  = block << kBlockShift;
+    size_t length = std::min(size_t(1) << kBlockShift, data_size - start);
+    ChessStats::Increment(ChessStats::CacheBlocksChecked);
+    if (HashBytes(data + start, length) != checksums[block]) {
+        memset(data + start, 0, length);
+        ChessStats::Increment(ChessStats::CacheBlocksDropped);
+    }
+
+    states[block].store(kChecked, std::memory_order_release);
+}
+
+void CacheFile::ValidateAll()
+{
+    for (size_t block = 0; block < block_count; ++block)
+        Validate(block << kBlockShift);
+}
+
+void CacheFile::MarkAllValid()
+{
+    for (size_t block = 0; block < block_count; ++block)
+        states[block].store(kChecked, std::memory_order_release);
+}
+
+bool CacheFile::Save(const char *path, Kind kind, uint32_t record_size,
+                     uint64_t fingerprint, uint64_t owner_value,
+                     const void *data, size_t size)
+{
+    CacheFileHeader header = {};
+    uint64_t        blocks = (size + (1 << kBlockShift) - 1) >> kBlockShift;
+
+    memcpy(header.magic, "CHCF", 4);
+    header.version     = kCacheFileVersion;
+    header.kind        = kind;
+    header.record_size = record_size;
+    header.fingerprint = fingerprint;
+    header.owner_value = owner_value;
+    header.data_size   = size;
+    header.block_count = blocks;
+
+    const char           *bytes = static_cast<const char *>(data);
+    std::vector<uint64_t> checksums(blocks);
+    for (uint64_t i = 0; i < blocks; ++i) {
+        size_t start = i << kBlockShift;
+        checksums[i] = HashBytes(bytes + start,
+                                 std::min(size_t(1) << kBlockShift,
+                                          size - start));
+    }
+    header.checksum = HeaderChecksum(header, checksums.data());
+
+    std::string temp = std::string(path) + ".tmp";
+    FILE       *out  = fopen(temp.c_str(), "wb");
+    if (!out)
+        return false;
+
+    std::vector<char> padding(DataOffset(blocks) - sizeof(header) -
+                              blocks * sizeof(uint64_t));
+    bool ok = fwrite(&header, sizeof(header), 1, out) == 1 &&
+              fwrite(checksums.data(), sizeof(uint64_t), blocks, out) ==
+                  blocks &&
+              fwrite(padding.data(), 1, padding.size(), out) ==
+                  padding.size() &&
+              fwrite(data, 1, size, out) == size;
+    ok = fclose(out) == 0 && ok;
+
+    if (!ok || rename(temp.c_str(), path) != 0) {
+        unlink(temp.c_str());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,83 @@
+#ifndef CHESS_CACHE_FILE_H
+#define CHESS_CACHE_FILE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Fast 64-bit hash of a byte range, for integrity checks and fingerprints;
+// not meant to resist deliberate collisions.
+uint64_t HashBytes(const void *data, size_t size, uint64_t seed = 0);
+
+// A cache saved to disk so it survives restarts. The file is a 64-byte
+// header, a checksum for every 64 KB block of data, then the data itself
+// starting on a page boundary:
+//
+//   "CHCF", format version, kind, record size, fingerprint, owner value,
+//   data size, block count, checksum of the header and block checksums
+//
+// Open maps the data copy-on-write, so a cache of any size is ready at
+// once and pages are only read when touched. Blocks are checked the first
+// time they are used; one that fails is zeroed, which to a cache just
+// means empty. The fingerprint names what the contents depend on (say the
+// evaluation), so a file from another setup is refused.
+class CacheFile {
+public:
+    enum Kind { TranspositionTableKind = 1, EvalCacheKind = 2 };
+
+    CacheFile() = default;
+    ~CacheFile();
+
+    CacheFile(const CacheFile &)            = delete;
+    CacheFile &operator=(const CacheFile &) = delete;
+
+    bool Open(const char *path, Kind kind, uint32_t record_size,
+              uint64_t fingerprint);
+    void Close();
+    void Swap(CacheFile &other);
+    bool IsOpen() const { return data != nullptr; }
+
+    void    *GetData() const { return data; }
+    size_t   GetSize() const { return data_size; }
+    uint64_t GetOwnerValue() const { return owner_value; }
+
+    // Call before reading or writing the data at `offset`. Cheap once its
+    // block has been checked.
+    void Validate(size_t offset)
+    {
+        if (states[offset >> kBlockShift].load(std::memory_order_acquire) !=
+            kChecked)
+            ValidateBlock(offset >> kBlockShift);
+    }
+    void ValidateAll();
+    // For when the owner has overwritten all of the data.
+    void MarkAllValid();
+
+    // Writes `data` to a new file next to `path`, then renames it over
+    // `path`, so a crash leaves the old file or the new one. `owner_value`
+    // is kept for the owner, e.g. a table's generation.
+    static bool Save(const char *path, Kind kind, uint32_t record_size,
+                     uint64_t fingerprint, uint64_t owner_value,
+                     const void *data, size_t size);
+
+private:
+    static const int     kBlockShift = 16;
+    static const uint8_t kUnchecked  = 0;
+    static const uint8_t kChecking   = 1;
+    static const uint8_t kChecked    = 2;
+
+    void    *mapping      = nullptr;
+    size_t   mapping_size = 0;
+    char    *data         = nullptr;
+    size_t   data_size    = 0;
+    uint64_t owner_value  = 0;
+
+    const uint64_t                         *checksums = nullptr;
+    std::unique_ptr<std::atomic<uint8_t>[]> states;
+    size_t                                  block_count = 0;
+
+    void ValidateBlock(size_t block);
+};
+
+#endif
@@ -0,0 +1,55 @@
+#include "chess_draw.h"
+
+void DrawTracker::Reset()
+{
+    keys.clear();
+    halfmove_clock = 0;
+}
+
+DrawTracker::Result DrawTracker::RecordPosition(const ChessBoard  &board,
+                                                TeamID             side_to_move,
+                                                const MoveHistory &history)
+{
+    // Pawn moves and captures reset the 50-move clock and end the span in
+    // which a position can repeat.
+    ChessMove last         = history.Last();
+    bool      irreversible = last.IsNull() || last.IsCapture() ||
+                             PieceCodeID(last.GetPiece()) == ChessPiece::Pawn;
+
+    halfmove_clock = irreversible || keys.empty() ? 0 : halfmove_clock + 1;
+    if (!board.ToPosition(side_to_move, history, halfmove_clock, position))
+        return NoDraw;
+
+    uint64_t key    = position.GetKey();
+    Result   result = NoDraw;
+
+    if (CountRepetitions(key, keys.data(), keys.size(), halfmove_clock, 2) >=
+        2)
+        result = Repetition;
+    else if (position.IsFiftyMoveDraw())
+        result = FiftyMoves;
+    else if (position.HasInsufficientMaterial())
+        result = InsufficientMaterial;
+
+    keys.push_back(key);
+    return result;
+}
+
+void DrawTracker::Undo(const ChessBoard &board, TeamID side_to_move,
+                       const MoveHistory &history)
+{
+    if (!keys.empty())
+        keys.pop_back();
+    halfmove_clock = history.HalfmoveClock();
+    board.ToPosition(side_to_move, history, halfmove_clock, position);
+}
+
+const char *DrawTracker::Describe(Result result)
+{
+    switch (result) {
+    case Repetition: return "threefold repetition";
+    case FiftyMoves: return "50-move rule";
+    case InsufficientMaterial: return "insufficient material";
+    default: return "no draw";
+    }
+}
@@ -0,0 +1,41 @@
+#ifndef CHESS_DRAW_H
+#define CHESS_DRAW_H
+
+#include <cstdint>
+#include <vector>
+
+#include "chess_board.h"
+#include "chess_pieces.h"
+#include "chess_position.h"
+
+// Follows a game played on a ChessBoard and tells when it is drawn by
+// threefold repetition, the 50-move rule or insufficient material.
+class DrawTracker {
+public:
+    enum Result { NoDraw, Repetition, FiftyMoves, InsufficientMaterial };
+
+    void Reset();
+
+    // Call with the position before the first move and after every move;
+    // `history` holds the moves played so far.
+    Result RecordPosition(const ChessBoard &board, TeamID side_to_move,
+                          const MoveHistory &history);
+
+    // Forgets the last recorded position after a move was taken back from
+    // `board` and `history`.
+    void Undo(const ChessBoard &board, TeamID side_to_move,
+              const MoveHistory &history);
+
+    static const char *Describe(Result result);
+
+    // The position last recorded; callers may generate moves from it as
+    // long as they leave it as they found it.
+    ChessPosition &GetPosition() { return position; }
+
+private:
+    ChessPosition         position;
+    std::vector<uint64_t> keys;
+    int                   halfmove_clock = 0;
+};
+
+#endif
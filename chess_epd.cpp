@@ -0,0 +1,88 @@
+#include "chess_epd.h"
+#include "chess_san.h"
+
+#include <cctype>
+#include <cstring>
+
+// Any white space ReadWord stops at, except the line's end.
+static void SkipSpaces(const char *&p)
+{
+    while (isspace(static_cast<unsigned char>(*p)) && *p != '\n' &&
+           *p != '\r')
+        ++p;
+}
+
+static std::string ReadWord(const char *&p)
+{
+    SkipSpaces(p);
+    const char *start = p;
+    while (*p && !isspace(static_cast<unsigned char>(*p)) && *p != ';')
+        ++p;
+    return std::string(start, p);
+}
+
+bool ParseEpd(const char *line, EpdRecord &record)
+{
+    const char *p = line;
+
+    record = EpdRecord();
+    for (int field = 0; field < 4; ++field) {
+        std::string word = ReadWord(p);
+        if (word.empty())
+            return false;
+        record.fen += word + ' ';
+    }
+    record.fen += "0 1";
+
+    // Operations: an opcode, operands separated by spaces, then ';'.
+    // Quoted operands may contain spaces and semicolons.
+    for (;;) {
+        std::string opcode = ReadWord(p);
+        if (opcode.empty() && !*p)
+            break;
+
+        std::vector<std::string> operands;
+        for (SkipSpaces(p); *p && *p != ';' && *p != '\n' && *p != '\r';
+             SkipSpaces(p)) {
+            if (*p == '"') {
+                const char *end = strchr(p + 1, '"');
+                if (!end)
+                    end = p + strlen(p);
+                operands.emplace_back(p + 1, end);
+                p = *end ? end + 1 : end;
+            } else {
+                operands.push_back(ReadWord(p));
+            }
+        }
+        if (*p == ';')
+            ++p;
+        else if (*p)
+            break;
+
+        if (opcode == "bm")
+            record.best_moves = operands;
+        else if (opcode == "am")
+            record.avoid_moves = operands;
+        else if (opcode == "id" && !operands.empty())
+            record.id = operands[0];
+    }
+    return true;
+}
+
+// Drops what SAN writers disagree on: check marks, annotations and '='.
+static std::string NormalizeSan(const std::string &san)
+{
+    std::string normalized;
+    for (char ch : san)
+        if (!strchr("+#!?=", ch))
+            normalized += ch == '0' ? 'O' : ch;
+    return normalized;
+}
+
+bool MoveMatches(const ChessPosition &position, const ChessMove &move,
+                 const std::string &notation)
+{
+    if (notation == move.ToString())
+        return true;
+    return NormalizeSan(notation) == NormalizeSan(MoveToSan(position, move));
+}
@@ -0,0 +1,28 @@
+#ifndef CHESS_EPD_H
+#define CHESS_EPD_H
+
+#include <string>
+#include <vector>
+
+#include "chess_position.h"
+
+// One line of an EPD test suite: the first four FEN fields, then
+// operations ending in ';'. Only the ones a test runner needs are kept:
+// bm (best moves), am (moves to avoid) and id. Moves are written in SAN.
+struct EpdRecord {
+    std::string              fen; // with clocks "0 1" appended
+    std::string              id;
+    std::vector<std::string> best_moves;
+    std::vector<std::string> avoid_moves;
+};
+
+// False for a line without the four position fields. Unknown operations
+// are skipped.
+bool ParseEpd(const char *line, EpdRecord &record);
+
+// Whether `notation` names `move`: SAN with or without check marks,
+// annotations or '=' before a promotion, "0-0" for castling, or UCI.
+bool MoveMatches(const ChessPosition &position, const ChessMove &move,
+                 const std::string &notation);
+
+#endif
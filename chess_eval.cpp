@@ -0,0 +1,105 @@
+#include "chess_eval.h"
+#include "chess_nnue.h"
+
+#include <algorithm>
+
+// Piece-square tables from white's point of view, laid out like the board
+// (a8 first), so black pieces look them up with the square mirrored.
+static const int kPieceSquare[6][64] = {
+    // Pawn
+    {  0,   0,   0,   0,   0,   0,   0,   0,
+      50,  50,  50,  50,  50,  50,  50,  50,
+      10,  10,  20,  30,  30,  20,  10,  10,
+       5,   5,  10,  25,  25,  10,   5,   5,
+       0,   0,   0,  20,  20,   0,   0,   0,
+       5,  -5, -10,   0,   0, -10,  -5,   5,
+       5,  10,  10, -20, -20,  10,  10,   5,
+       0,   0,   0,   0,   0,   0,   0,   0},
+    // Knight
+    {-50, -40, -30, -30, -30, -30, -40, -50,
+     -40, -20,   0,   0,   0,   0, -20, -40,
+     -30,   0,  10,  15,  15,  10,   0, -30,
+     -30,   5,  15,  20,  20,  15,   5, -30,
+     -30,   0,  15,  20,  20,  15,   0, -30,
+     -30,   5,  10,  15,  15,  10,   5, -30,
+     -40, -20,   0,   5,   5,   0, -20, -40,
+     -50, -40, -30, -30, -30, -30, -40, -50},
+    // Bishop
+    {-20, -10, -10, -10, -10, -10, -10, -20,
+     -10,   0,   0,   0,   0,   0,   0, -10,
+     -10,   0,   5,  10,  10,   5,   0, -10,
+     -10,   5,   5,  10,  10,   5,   5, -10,
+     -10,   0,  10,  10,  10,  10,   0, -10,
+     -10,  10,  10,  10,  10,  10,  10, -10,
+     -10,   5,   0,   0,   0,   0,   5, -10,
+     -20, -10, -10, -10, -10, -10, -10, -20},
+    // Rook
+    {  0,   0,   0,   0,   0,   0,   0,   0,
+       5,  10,  10,  10,  10,  10,  10,   5,
+      -5,   0,   0,   0,   0,   0,   0,  -5,
+      -5,   0,   0,   0,   0,   0,   0,  -5,
+      -5,   0,   0,   0,   0,   0,   0,  -5,
+      -5,   0,   0,   0,   0,   0,   0,  -5,
+      -5,   0,   0,   0,   0,   0,   0,  -5,
+       0,   0,   0,   5,   5,   0,   0,   0},
+    // Queen
+    {-20, -10, -10,  -5,  -5, -10, -10, -20,
+     -10,   0,   0,   0,   0,   0,   0, -10,
+     -10,   0,   5,   5,   5,   5,   0, -10,
+      -5,   0,   5,   5,   5,   5,   0,  -5,
+       0,   0,   5,   5,   5,   5,   0,  -5,
+     -10,   5,   5,   5,   5,   5,   0, -10,
+     -10,   0,   5,   0,   0,   0,   0, -10,
+     -20, -10, -10,  -5,  -5, -10, -10, -20},
+    // King
+    {-30, -40, -40, -50, -50, -40, -40, -30,
+     -30, -40, -40, -50, -50, -40, -40, -30,
+     -30, -40, -40, -50, -50, -40, -40, -30,
+     -30, -40, -40, -50, -50, -40, -40, -30,
+     -20, -30, -30, -40, -40, -30, -30, -20,
+     -10, -20, -20, -20, -20, -20, -20, -10,
+      20,  20,   0,   0,   0,   0,  20,  20,
+      20,  30,  10,   0,   0,  10,  30,  20},
+};
+
+int PieceSquareValue(ChessPiece::PieceID id, int square)
+{
+    return kPieceValues[id] + kPieceSquare[id][square];
+}
+
+int Evaluate(const ChessPosition &position)
+{
+    // The network's output is not bounded by anything.
+    const NnueNetwork *network = position.GetNetwork();
+    int score = network ? network->Evaluate(position.GetAccumulator(),
+                                            position.GetSideToMove())
+                        : EvaluateClassical(position);
+    return std::max(-kMaxEvaluation, std::min(score, kMaxEvaluation));
+}
+
+// Change whenever the classical evaluation or the tables above change.
+const uint64_t kClassicalFingerprint = 0x636c617373696301ULL;
+
+uint64_t EvaluationFingerprint(const NnueNetwork *network)
+{
+    return network ? network->GetFingerprint() : kClassicalFingerprint;
+}
+
+int EvaluateClassical(const ChessPosition &position)
+{
+    int score = 0;
+
+    for (int square = 0; square < 64; ++square) {
+        PieceCode piece = position.GetPiece(square);
+        if (!piece)
+            continue;
+
+        ChessPiece::PieceID id = PieceCodeID(piece);
+        if (PieceCodeTeam(piece) == TeamID::White)
+            score += kPieceValues[id] + kPieceSquare[id][square];
+        else
+            score -= kPieceValues[id] + kPieceSquare[id][square ^ 56];
+    }
+
+    return position.GetSideToMove() == TeamID::White ? score : -score;
+}
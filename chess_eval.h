@@ -0,0 +1,25 @@
+#ifndef CHESS_EVAL_H
+#define CHESS_EVAL_H
+
+#include "chess_position.h"
+
+const int kPieceValues[] = {100, 320, 330, 500, 900, 0};
+
+// Static scores never go past this, which keeps them clear of mate scores
+// and lets them be stored in 16 bits.
+const int kMaxEvaluation = 30000;
+
+// Static evaluation in centipawns from the side to move's point of view;
+// uses the position's network when it has one.
+int Evaluate(const ChessPosition &position);
+int EvaluateClassical(const ChessPosition &position);
+
+// Identifies what Evaluate computes with `network` (or without one), so
+// saved caches of scores are not reused under a different evaluation.
+uint64_t EvaluationFingerprint(const NnueNetwork *network);
+
+// Material plus piece-square bonus of a white piece on `square`; black
+// pieces look it up with the square mirrored (square ^ 56).
+int PieceSquareValue(ChessPiece::PieceID id, int square);
+
+#endif
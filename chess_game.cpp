@@ -1,12 +1,26 @@
 #include "chess_game.h"
+#include "chess_stats.h"
 
-ChessGame::ChessGame() : last_turn(), game_board()
+#include <cstring>
+#include <string>
+#include <vector>
+
+const int kStatusRow = 10;
+const int kStatsRow  = 11;
+const int kStatsRows = ChessStats::CounterCount + ChessStats::TimerCount;
+
+ChessGame::ChessGame(InputReplay *replay, InputRecorder *recorder)
+    : history(), game_board(), replay(replay), recorder(recorder)
 {
+    start_ns = ChessStats::NowNs();
+
     InitScreen();
-    InitColors();
+    ChessBoard::InitColors();
 
     game_board.DrawBoardBorder();
     game_board.DrawBoard();
+
+    UpdateLegalMoves();
 }
 
 ChessGame::~ChessGame()
@@ -19,19 +33,121 @@ void ChessGame::Chess()
 {
     while (!exit) {
         HandleInput();
-        if (game_board.MovePiece(team_current_turn, from_x, from_y, to_x, to_y,
-                                 last_turn)) {
+
+        if (undo) {
+            undo = false;
+            if (game_board.UndoMove(history)) {
+                team_current_turn = team_current_turn == TeamID::White
+                                        ? TeamID::Black
+                                        : TeamID::White;
+                draw_tracker.Undo(game_board, team_current_turn, history);
+                // The game went on from here, so it is no longer over.
+                DrawStatus("");
+                RefreshLegalMoves(DrawTracker::NoDraw);
+            }
+        } else if (!exit) {
+            // HandleInput only returns a move that is in the legal move cache.
+            ChessMove move = ChessBoard::MatchMove(
+                legal_moves, SquareIndex(from_x, from_y),
+                SquareIndex(to_x, to_y));
+
+            game_board.ApplyMove(move, history);
+            ChessStats::Increment(ChessStats::MovesValidated);
+            ChessStats::RecordTime(ChessStats::InputToMove,
+                                   ChessStats::NowNs() - input_time_ns);
             team_current_turn = team_current_turn == TeamID::White
                                     ? TeamID::Black
                                     : TeamID::White;
+            UpdateLegalMoves();
         }
         game_board.DrawBoard();
+        if (show_stats)
+            DrawStats();
         refresh();
+
+        if (!exit && input_time_ns) {
+            ChessStats::RecordTime(ChessStats::InputToRender,
+                                   ChessStats::NowNs() - input_time_ns);
+            input_time_ns = 0;
+        }
+    }
+}
+
+void ChessGame::UpdateLegalMoves()
+{
+    RefreshLegalMoves(
+        draw_tracker.RecordPosition(game_board, team_current_turn, history));
+}
+
+void ChessGame::RefreshLegalMoves(DrawTracker::Result draw)
+{
+    draw_tracker.GetPosition().GenerateLegalMoves(legal_moves);
+
+    memset(legal_targets, 0, sizeof(legal_targets));
+    for (int i = 0; i < legal_moves.Size(); ++i) {
+        const ChessMove &move = legal_moves[i];
+
+        legal_targets[move.GetFrom()] |= uint64_t(1) << move.GetTo();
+        if (move.GetFlag() == ChessMove::Castling)
+            legal_targets[move.GetFrom()] |= uint64_t(1)
+                                             << CastlingRookSquare(move);
+    }
+
+    char status[64];
+    if (draw != DrawTracker::NoDraw) {
+        snprintf(status, sizeof(status), "Draw by %s. q to quit.",
+                 DrawTracker::Describe(draw));
+    } else if (legal_moves.Size() == 0) {
+        if (draw_tracker.GetPosition().IsInCheck())
+            snprintf(status, sizeof(status), "Checkmate, %s wins. q to quit.",
+                     team_current_turn == TeamID::White ? "black" : "white");
+        else
+            snprintf(status, sizeof(status), "Stalemate. q to quit.");
+    } else {
+        return;
+    }
+
+    // Nothing is selectable once the game is over.
+    memset(legal_targets, 0, sizeof(legal_targets));
+    DrawStatus(status);
+}
+
+bool ChessGame::IsLegalTarget(int from_x, int from_y, int to_x,
+                              int to_y) const
+{
+    return legal_targets[SquareIndex(from_x, from_y)] >>
+               SquareIndex(to_x, to_y) &
+           1;
+}
+
+void ChessGame::HighlightTargets(int x, int y) const
+{
+    game_board.HighlightBoardCell(x, y);
+    for (uint64_t targets = legal_targets[SquareIndex(x, y)]; targets;
+         targets &= targets - 1) {
+        int square = __builtin_ctzll(targets);
+        game_board.HighlightBoardCell(SquareX(square), SquareY(square));
+    }
+}
+
+void ChessGame::ClearTargets(int x, int y) const
+{
+    game_board.DrawBoardCell(x, y);
+    for (uint64_t targets = legal_targets[SquareIndex(x, y)]; targets;
+         targets &= targets - 1) {
+        int square = __builtin_ctzll(targets);
+        game_board.DrawBoardCell(SquareX(square), SquareY(square));
     }
 }
 
 void ChessGame::InitScreen()
 {
+    if (replay) {
+        // The caller's screen only has to take drawing; see OpenNullTerminal.
+        start_color();
+        return;
+    }
+
     initscr();
     noecho();
     cbreak();
@@ -43,51 +159,91 @@ void ChessGame::InitScreen()
     refresh();
 }
 
-void ChessGame::InitColors()
+bool ChessGame::ReadEvent(InputEvent &event)
 {
-    init_pair(1, COLOR_WHITE, COLOR_BLUE);
-    init_pair(2, COLOR_WHITE, COLOR_CYAN);
-    init_pair(3, COLOR_BLACK, COLOR_BLUE);
-    init_pair(4, COLOR_BLACK, COLOR_CYAN);
-    init_pair(5, COLOR_WHITE, COLOR_RED);
-    init_pair(6, COLOR_BLACK, COLOR_RED);
-    init_pair(7, COLOR_WHITE, COLOR_YELLOW);
-    init_pair(8, COLOR_BLACK, COLOR_YELLOW);
+    if (replay)
+        return replay->Next(event);
+
+    event         = InputEvent();
+    event.key     = getch();
+    event.time_us = (ChessStats::NowNs() - start_ns) / 1000;
+
+    if (event.key == KEY_MOUSE) {
+        MEVENT mouse;
+        if (getmouse(&mouse) != OK)
+            return true;
+
+        event.x = mouse.x;
+        event.y = mouse.y;
+        if (mouse.bstate & BUTTON1_PRESSED)
+            event.button = InputEvent::LeftPress;
+        else if (mouse.bstate & BUTTON3_PRESSED)
+            event.button = InputEvent::RightPress;
+    }
+
+    if (recorder && event.key != ERR)
+        recorder->Record(event);
+    return true;
 }
 
 void ChessGame::HandleInput()
 {
-    bool selected = false, success = false;
-    int  key, converted_x, converted_y;
+    bool       selected = false, success = false;
+    int        converted_x, converted_y;
+    InputEvent event;
     while (!success) {
-        key = getch();
-        switch (key) {
+        // The end of a replay quits like 'q' does.
+        if (!ReadEvent(event)) {
+            exit = true;
+            break;
+        }
+        switch (event.key) {
         case KEY_MOUSE:
-            if (getmouse(&mouse_event) == OK) {
-                if (mouse_event.bstate & BUTTON1_PRESSED) {
-                    converted_x = (mouse_event.x - 2) / 2;
-                    converted_y = mouse_event.y - 1;
-                    if (converted_x >= 0 && converted_x < 8 &&
-                        converted_y >= 0 && converted_y < 8) {
-                        if (!selected &&
-                            !game_board.IsCellEmpty(converted_x, converted_y)) {
-                            from_x = converted_x;
-                            from_y = converted_y;
-                            game_board.HighlightBoardCell(from_x, from_y);
-                            selected = true;
-                        } else {
-                            to_x    = converted_x;
-                            to_y    = converted_y;
-                            success = true;
-                        }
+            if (event.button == InputEvent::LeftPress) {
+                converted_x = (event.x - 2) / 2;
+                converted_y = event.y - 1;
+                if (converted_x >= 0 && converted_x < 8 &&
+                    converted_y >= 0 && converted_y < 8) {
+                    if (selected && IsLegalTarget(from_x, from_y,
+                                                  converted_x,
+                                                  converted_y)) {
+                        to_x          = converted_x;
+                        to_y          = converted_y;
+                        input_time_ns = ChessStats::NowNs();
+                        success       = true;
+                    } else if (legal_targets[SquareIndex(converted_x,
+                                                         converted_y)]) {
+                        if (selected)
+                            ClearTargets(from_x, from_y);
+                        from_x = converted_x;
+                        from_y = converted_y;
+                        HighlightTargets(from_x, from_y);
+                        selected = true;
+                    } else if (selected) {
+                        ChessStats::Increment(ChessStats::MovesRejected);
                     }
-                } else if (mouse_event.bstate & BUTTON3_PRESSED) {
-                    if (selected)
-                        game_board.DrawBoardCell(from_x, from_y);
-                    selected = false;
                 }
+            } else if (event.button == InputEvent::RightPress) {
+                if (selected)
+                    ClearTargets(from_x, from_y);
+                selected = false;
             }
             break;
+        case 's':
+            show_stats = !show_stats;
+            if (show_stats)
+                DrawStats();
+            else
+                ClearStats();
+            refresh();
+            break;
+        case 'u':
+            if (selected)
+                ClearTargets(from_x, from_y);
+            undo          = true;
+            input_time_ns = ChessStats::NowNs();
+            success       = true;
+            break;
         case 'q':
             exit    = true;
             success = true;
@@ -98,3 +254,31 @@ void ChessGame::HandleInput()
     }
 }
 
+
+void ChessGame::DrawStatus(const char *status) const
+{
+    move(kStatusRow, 0);
+    clrtoeol();
+    mvaddnstr(kStatusRow, 0, status, COLS);
+}
+
+void ChessGame::DrawStats() const
+{
+    ChessStats::Snapshot     snapshot;
+    std::vector<std::string> lines;
+
+    ChessStats::Collect(snapshot);
+    ChessStats::Format(snapshot, lines);
+
+    ClearStats();
+    for (size_t i = 0; i < lines.size(); ++i)
+        mvaddnstr(kStatsRow + i, 0, lines[i].c_str(), COLS);
+}
+
+void ChessGame::ClearStats() const
+{
+    for (int i = 0; i < kStatsRows; ++i) {
+        move(kStatsRow + i, 0);
+        clrtoeol();
+    }
+}
@@ -1,35 +1,64 @@
 #ifndef CHESS_GAME_H
 #define CHESS_GAME_H
 
+#include <cstdint>
 #include <ncurses.h>
 
 #include "chess_board.h"
+#include "chess_draw.h"
+#include "chess_input.h"
 #include "chess_pieces.h"
 
 class ChessBoard;
 class ChessPiece;
-class TurnInfo;
 
 class ChessGame {
-    TeamID   team_current_turn = TeamID::White;
-    TurnInfo last_turn;
+    TeamID      team_current_turn = TeamID::White;
+    MoveHistory history;
 
-    ChessBoard game_board;
+    ChessBoard  game_board;
+    DrawTracker draw_tracker;
 
-    bool   exit = false;
+    bool   exit      = false;
+    bool   undo      = false; // HandleInput asks for a take-back
     int    from_x, from_y, to_x, to_y;
-    MEVENT mouse_event;
+
+    // Events come from the terminal, or from a recording when replaying
+    // into a screen the caller has set up; either way they can be logged.
+    InputReplay   *replay;
+    InputRecorder *recorder;
+    uint64_t       start_ns;
+
+    bool     show_stats    = false;
+    uint64_t input_time_ns = 0; // 0 when no timed input is pending
+
+    // Legal moves of the current ply, computed once after each move, and
+    // for every square a bitmask of the cells its piece may be dropped on.
+    ChessMoveList legal_moves;
+    uint64_t      legal_targets[64];
 
 public:
-    ChessGame();
+    explicit ChessGame(InputReplay *replay = nullptr,
+                       InputRecorder *recorder = nullptr);
     ~ChessGame();
 
+    const ChessBoard &GetBoard() const { return game_board; }
+
     void Chess();
 
 private:
     void InitScreen();
-    void InitColors();
+    bool ReadEvent(InputEvent &event);
     void HandleInput();
+    // Records the position just reached and refreshes the move cache.
+    void UpdateLegalMoves();
+    void RefreshLegalMoves(DrawTracker::Result draw);
+    bool IsLegalTarget(int from_x, int from_y, int to_x, int to_y) const;
+    void HighlightTargets(int x, int y) const;
+    void ClearTargets(int x, int y) const;
+    void DrawStatus(const char *status) const;
+    void DrawStats() const;
+    void ClearStats() const;
 };
 
 #endif
@@ -0,0 +1,99 @@
+#include "chess_headless.h"
+#include "chess_stats.h"
+
+#include <cstring>
+
+HeadlessGame::HeadlessGame()
+{
+    draw_tracker.RecordPosition(game_board, team_current_turn, history);
+}
+
+void HeadlessGame::Run(FILE *in, FILE *out)
+{
+    char line[256];
+
+    while (fgets(line, sizeof(line), in)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (!HandleCommand(line, out))
+            break;
+        fflush(out);
+    }
+}
+
+// Commands:
+//   move <from><to>  e.g. "move e2e4", answers "ok" or "illegal"; a move
+//                    that draws the game answers "ok draw <reason>"
+//   undo             takes back the last move, answers "ok" or
+//                    "error nothing to undo"
+//   board            prints the board, white pieces in upper case
+//   pgn              prints the game so far as PGN
+//   stats            dumps the performance counters
+//   quit
+bool HeadlessGame::HandleCommand(char *line, FILE *out)
+{
+    char *command = strtok(line, " \t");
+    if (!command)
+        return true;
+
+    if (!strcmp(command, "move")) {
+        char *arg = strtok(nullptr, " \t");
+        int   from_x, from_y, to_x, to_y;
+
+        if (!arg || strlen(arg) != 4 || !ParseSquare(arg, from_x, from_y) ||
+            !ParseSquare(arg + 2, to_x, to_y)) {
+            fprintf(out, "error bad move\n");
+        } else if (game_over) {
+            fprintf(out, "error game over\n");
+        } else {
+            if (game_board.MovePiece(team_current_turn, from_x, from_y, to_x,
+                                     to_y, history)) {
+                team_current_turn = team_current_turn == TeamID::White
+                                        ? TeamID::Black
+                                        : TeamID::White;
+
+                DrawTracker::Result draw = draw_tracker.RecordPosition(
+                    game_board, team_current_turn, history);
+                if (draw != DrawTracker::NoDraw) {
+                    fprintf(out, "ok draw %s\n", DrawTracker::Describe(draw));
+                    game_over = true;
+                } else {
+                    fprintf(out, "ok\n");
+                }
+            } else {
+                fprintf(out, "illegal\n");
+            }
+        }
+    } else if (!strcmp(command, "undo")) {
+        if (game_board.UndoMove(history)) {
+            team_current_turn = team_current_turn == TeamID::White
+                                    ? TeamID::Black
+                                    : TeamID::White;
+            draw_tracker.Undo(game_board, team_current_turn, history);
+            game_over = false;
+            fprintf(out, "ok\n");
+        } else {
+            fprintf(out, "error nothing to undo\n");
+        }
+    } else if (!strcmp(command, "board")) {
+        PrintBoard(out);
+    } else if (!strcmp(command, "pgn")) {
+        history.WritePgn(out);
+    } else if (!strcmp(command, "stats")) {
+        ChessStats::Dump(out);
+    } else if (!strcmp(command, "quit")) {
+        return false;
+    } else {
+        fprintf(out, "error unknown command\n");
+    }
+
+    return true;
+}
+
+void HeadlessGame::PrintBoard(FILE *out) const
+{
+    for (int y = 0; y < kBoardSize; ++y) {
+        for (int x = 0; x < kBoardSize; ++x)
+            fputc(game_board.GetCellChar(x, y), out);
+        fputc('\n', out);
+    }
+}
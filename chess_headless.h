@@ -0,0 +1,29 @@
+#ifndef CHESS_HEADLESS_H
+#define CHESS_HEADLESS_H
+
+#include <cstdio>
+
+#include "chess_board.h"
+#include "chess_draw.h"
+#include "chess_pieces.h"
+
+// Plays a game over a line-based text protocol instead of the ncurses UI.
+class HeadlessGame {
+    TeamID      team_current_turn = TeamID::White;
+    MoveHistory history;
+
+    ChessBoard  game_board;
+    DrawTracker draw_tracker;
+    bool        game_over = false;
+
+public:
+    HeadlessGame();
+
+    void Run(FILE *in, FILE *out);
+
+private:
+    bool HandleCommand(char *line, FILE *out);
+    void PrintBoard(FILE *out) const;
+};
+
+#endif
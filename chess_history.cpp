@@ -0,0 +1,92 @@
+#include "chess_history.h"
+#include "chess_san.h"
+
+#include <cstring>
+#include <string>
+
+// PGN export lines stay within 80 columns.
+const size_t kPgnLineWidth = 79;
+
+int MoveHistory::HalfmoveClock() const
+{
+    int clock = 0;
+    for (size_t i = moves.size(); i > 0; --i, ++clock) {
+        const ChessMove &move = moves[i - 1];
+        if (move.IsCapture() ||
+            PieceCodeID(move.GetPiece()) == ChessPiece::Pawn)
+            break;
+    }
+    return clock;
+}
+
+bool MoveHistory::WasReached(int square) const
+{
+    for (size_t i = moves.size(); i > 0; --i) {
+        const ChessMove &move = moves[i - 1];
+        if (move.GetTo() == square ||
+            (move.GetFlag() == ChessMove::Castling &&
+             (move.GetFrom() + move.GetTo()) / 2 == square))
+            return true;
+    }
+    return false;
+}
+
+static void AppendToken(FILE *out, std::string &line, const std::string &token)
+{
+    if (!line.empty() && line.size() + 1 + token.size() > kPgnLineWidth) {
+        fprintf(out, "%s\n", line.c_str());
+        line.clear();
+    }
+    if (!line.empty())
+        line += ' ';
+    line += token;
+}
+
+bool MoveHistory::WritePgn(FILE *out, const char *result,
+                           const char *start_fen) const
+{
+    ChessPosition position;
+    if (!position.SetFromFen(start_fen))
+        return false;
+
+    int number = 1;
+    sscanf(start_fen, "%*s %*s %*s %*s %*d %d", &number);
+
+    fprintf(out, "[Event \"?\"]\n[Site \"?\"]\n[Date \"????.??.??\"]\n"
+                 "[Round \"?\"]\n[White \"?\"]\n[Black \"?\"]\n"
+                 "[Result \"%s\"]\n",
+            result);
+    if (strcmp(start_fen, ChessPosition::kStartFen))
+        fprintf(out, "[SetUp \"1\"]\n[FEN \"%s\"]\n", start_fen);
+    fputc('\n', out);
+
+    std::string line;
+    for (size_t i = 0; i < moves.size(); ++i) {
+        const ChessMove &move = moves[i];
+        CheckInfo        info;
+        position.ComputeCheckInfo(info);
+        if (!position.IsPseudoLegal(move) || !position.IsLegal(move, info))
+            return false;
+
+        bool        white = position.GetSideToMove() == TeamID::White;
+        std::string token;
+        if (white || i == 0)
+            token = std::to_string(number) + (white ? ". " : "... ");
+        // The move is made here anyway, so check marks come from that.
+        token += MoveToSan(position, move, false);
+        position.MakeMove(move);
+        if (position.IsInCheck()) {
+            ChessMoveList replies;
+            position.GenerateLegalMoves(replies);
+            token += replies.Size() ? '+' : '#';
+        }
+        if (!white)
+            ++number;
+
+        AppendToken(out, line, token);
+    }
+
+    AppendToken(out, line, result);
+    fprintf(out, "%s\n\n", line.c_str());
+    return !ferror(out);
+}
@@ -0,0 +1,63 @@
+#ifndef CHESS_HISTORY_H
+#define CHESS_HISTORY_H
+
+#include <cstddef>
+#include <cstdio>
+#include <vector>
+
+#include "chess_position.h"
+
+// Every move of a game in order, as packed 32-bit ChessMoves in one
+// contiguous vector, so a million moves take 4 MB and are walked at memory
+// speed. A move names its moving and captured pieces, which is all it
+// takes to undo it.
+class MoveHistory {
+public:
+    typedef std::vector<ChessMove>::const_iterator Iterator;
+
+    void Reserve(size_t count) { moves.reserve(count); }
+    void Clear() { moves.clear(); }
+    void Push(const ChessMove &move) { moves.push_back(move); }
+    // Removes and returns the last move; a null move when there is none.
+    ChessMove Pop()
+    {
+        if (moves.empty())
+            return ChessMove();
+        ChessMove move = moves.back();
+        moves.pop_back();
+        return move;
+    }
+
+    size_t           Size() const { return moves.size(); }
+    bool             Empty() const { return moves.empty(); }
+    const ChessMove &operator[](size_t i) const { return moves[i]; }
+    ChessMove Last() const { return moves.empty() ? ChessMove() : moves.back(); }
+    Iterator  begin() const { return moves.begin(); }
+    Iterator  end() const { return moves.end(); }
+
+    // The square the last move's pawn skipped, where it can be taken en
+    // passant; kNoSquare when the last move was no double push.
+    int EnPassantSquare() const
+    {
+        ChessMove last = Last();
+        return last.GetFlag() == ChessMove::DoublePush
+                   ? (last.GetFrom() + last.GetTo()) / 2
+                   : kNoSquare;
+    }
+    // Plies since the last capture or pawn move, as the fifty-move rule
+    // counts them.
+    int HalfmoveClock() const;
+    // Whether any move put a piece on `square`, castling rooks included;
+    // whatever stands there has then moved at some point.
+    bool WasReached(int square) const;
+
+    // Writes the game as PGN, replaying it from `start_fen`. False when a
+    // move does not fit the position it is played in.
+    bool WritePgn(FILE *out, const char *result = "*",
+                  const char *start_fen = ChessPosition::kStartFen) const;
+
+private:
+    std::vector<ChessMove> moves;
+};
+
+#endif
@@ -0,0 +1,107 @@
+#include "chess_input.h"
+
+#include <cstdlib>
+#include <cstring>
+
+static const char kHeader[] = "# chess input 1\n";
+
+InputRecorder::~InputRecorder()
+{
+    if (file)
+        fclose(file);
+}
+
+bool InputRecorder::Open(const char *path)
+{
+    file = fopen(path, "w");
+    return file && fputs(kHeader, file) >= 0;
+}
+
+void InputRecorder::Record(const InputEvent &event)
+{
+    static const char *const kButtons[] = {"none", "left", "right"};
+
+    if (!file)
+        return;
+
+    if (event.key == KEY_MOUSE)
+        fprintf(file, "%llu mouse %d %d %s\n",
+                static_cast<unsigned long long>(event.time_us), event.x,
+                event.y, kButtons[event.button]);
+    else
+        fprintf(file, "%llu key %d\n",
+                static_cast<unsigned long long>(event.time_us), event.key);
+
+    // A crashing session is exactly the one worth replaying.
+    fflush(file);
+}
+
+InputReplay::~InputReplay()
+{
+    if (file)
+        fclose(file);
+}
+
+bool InputReplay::Open(const char *path)
+{
+    char header[sizeof(kHeader)];
+
+    file = fopen(path, "r");
+    line = 1;
+    return file && fgets(header, sizeof(header), file) &&
+           !strcmp(header, kHeader);
+}
+
+bool InputReplay::Next(InputEvent &event)
+{
+    char               buf[128], type[16], button[16];
+    unsigned long long time_us;
+
+    while (file && !error && fgets(buf, sizeof(buf), file)) {
+        ++line;
+        if (buf[0] == '#' || buf[0] == '\n')
+            continue;
+
+        event = InputEvent();
+        if (sscanf(buf, "%llu %15s", &time_us, type) != 2) {
+            error = true;
+            break;
+        }
+        event.time_us = time_us;
+
+        if (!strcmp(type, "key")) {
+            error = sscanf(buf, "%*u %*s %d", &event.key) != 1;
+        } else if (!strcmp(type, "mouse") &&
+                   sscanf(buf, "%*u %*s %d %d %15s", &event.x, &event.y,
+                          button) == 3) {
+            event.key = KEY_MOUSE;
+            if (!strcmp(button, "left"))
+                event.button = InputEvent::LeftPress;
+            else if (!strcmp(button, "right"))
+                event.button = InputEvent::RightPress;
+        } else {
+            error = true;
+        }
+        return !error;
+    }
+    return false;
+}
+
+SCREEN *OpenNullTerminal()
+{
+    FILE *out = fopen("/dev/null", "w");
+    FILE *in  = fopen("/dev/null", "r");
+    if (!out || !in)
+        return nullptr;
+
+    const char *term   = getenv("TERM");
+    SCREEN     *screen = newterm(term ? term : "ansi", out, in);
+    if (!screen)
+        screen = newterm("ansi", out, in);
+    if (!screen)
+        return nullptr;
+
+    set_term(screen);
+    start_color();
+    return screen;
+}
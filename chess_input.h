@@ -0,0 +1,57 @@
+#ifndef CHESS_INPUT_H
+#define CHESS_INPUT_H
+
+#include <cstdint>
+#include <cstdio>
+#include <ncurses.h>
+
+// One key or mouse event as ChessGame::HandleInput sees it. Mouse events
+// have key == KEY_MOUSE and keep only the buttons the game reacts to, so
+// recordings do not depend on the ncurses mouse mask ABI.
+struct InputEvent {
+    enum Button { NoButton, LeftPress, RightPress };
+
+    uint64_t time_us = 0; // since the start of the game
+    int      key     = ERR;
+    int      x = 0, y = 0;
+    Button   button  = NoButton;
+};
+
+// Event log, one event per line after a version header:
+//
+//   # chess input 1
+//   <us> key <code>
+//   <us> mouse <x> <y> <left|right|none>
+//
+// The game has no timing dependent rules, so replaying the events in order
+// reproduces a recorded game exactly; the times are kept for reference.
+class InputRecorder {
+    FILE *file = nullptr;
+
+public:
+    ~InputRecorder();
+
+    bool Open(const char *path);
+    void Record(const InputEvent &event);
+};
+
+class InputReplay {
+    FILE *file  = nullptr;
+    int   line  = 0;
+    bool  error = false;
+
+public:
+    ~InputReplay();
+
+    bool Open(const char *path);
+    // False at the end of the log or on a malformed line.
+    bool Next(InputEvent &event);
+    bool HasError() const { return error; }
+    int  GetLine() const { return line; }
+};
+
+// A curses screen that renders to /dev/null, for replays and benchmarks.
+// Colors are started; the caller defines its pairs.
+SCREEN *OpenNullTerminal();
+
+#endif
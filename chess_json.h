@@ -0,0 +1,27 @@
+#ifndef CHESS_JSON_H
+#define CHESS_JSON_H
+
+#include <cstdio>
+#include <string>
+
+// Escapes `str` for use inside a JSON string: quotes, backslashes and
+// control characters. Report writers use it for names they do not control.
+inline std::string JsonEscape(const std::string &str)
+{
+    std::string escaped;
+    for (char ch : str) {
+        if (ch == '"' || ch == '\\') {
+            escaped += '\\';
+            escaped += ch;
+        } else if (static_cast<unsigned char>(ch) < 0x20) {
+            char code[8];
+            snprintf(code, sizeof(code), "\\u%04x", ch);
+            escaped += code;
+        } else {
+            escaped += ch;
+        }
+    }
+    return escaped;
+}
+
+#endif
@@ -0,0 +1,290 @@
+#include "chess_mate.h"
+#include "chess_stats.h"
+
+#include <cstring>
+#include <new>
+
+// Numbers saturate here; a position with one of them this big is settled
+// the other way.
+const uint32_t kInfinity = 1u << 30;
+
+static uint32_t AddNumbers(uint32_t a, uint32_t b)
+{
+    return a + b < kInfinity ? a + b : kInfinity;
+}
+
+bool MateSolver::Resize(size_t megabytes)
+{
+    uint64_t count = (megabytes << 20) / sizeof(Cluster);
+    if (count < 1)
+        count = 1;
+
+    clusters.reset(new (std::nothrow) Cluster[count]);
+    cluster_count = clusters ? count : 0;
+    Clear();
+    return clusters != nullptr;
+}
+
+void MateSolver::Clear()
+{
+    if (clusters)
+        memset(clusters.get(), 0, cluster_count * sizeof(Cluster));
+}
+
+const MateSolver::Entry *MateSolver::Lookup(uint64_t key, int remaining) const
+{
+    const Cluster &cluster = clusters[static_cast<uint64_t>(
+        (static_cast<unsigned __int128>(key) * cluster_count) >> 64)];
+    const Entry *found = nullptr;
+
+    // A mate with fewer moves to spare is still one with more, and no mate
+    // with more moves means none with fewer.
+    for (const Entry &entry : cluster.entries) {
+        if (!entry.work || entry.key != key)
+            continue;
+        if ((entry.proof == 0 && entry.remaining <= remaining) ||
+            (entry.disproof == 0 && entry.remaining >= remaining))
+            return &entry;
+        if (entry.remaining == remaining)
+            found = &entry;
+    }
+    return found;
+}
+
+void MateSolver::Store(uint64_t key, int remaining, uint32_t proof,
+                       uint32_t disproof, const ChessMove &move, int plies,
+                       uint64_t work)
+{
+    Cluster &cluster = clusters[static_cast<uint64_t>(
+        (static_cast<unsigned __int128>(key) * cluster_count) >> 64)];
+    Entry   *replace = &cluster.entries[0];
+
+    // The entry that took the least work to fill is the cheapest to lose;
+    // empty ones took none.
+    for (Entry &entry : cluster.entries) {
+        if (entry.work && entry.key == key && entry.remaining == remaining) {
+            work += entry.work;
+            replace = &entry;
+            break;
+        }
+        if (entry.work < replace->work)
+            replace = &entry;
+    }
+
+    replace->key       = key;
+    replace->proof     = proof;
+    replace->disproof  = disproof;
+    replace->work      = work < UINT32_MAX ? static_cast<uint32_t>(work)
+                                           : UINT32_MAX;
+    replace->move      = move.ToRaw();
+    replace->remaining = static_cast<uint8_t>(remaining);
+    replace->plies     = static_cast<uint8_t>(plies);
+}
+
+// Negamax form of df-pn: phi is the proof number of the side to move
+// (theirs to win, that is) and delta its disproof number, so a position's
+// phi is the smallest delta among its children and its delta the sum of
+// their phis. `remaining` counts the plies left for the mate.
+void MateSolver::Mid(ChessPosition &position, int remaining,
+                     uint32_t phi_threshold, uint32_t delta_threshold)
+{
+    uint64_t key         = position.GetKey();
+    uint64_t start_nodes = nodes++;
+    bool     attacking   = position.GetSideToMove() == attacker;
+
+    ChessMoveList moves;
+    position.GenerateLegalMoves(moves);
+
+    // Without a move the game is over; without plies left it is over for
+    // the attacker, whose last move did not mate.
+    if (moves.Size() == 0 || remaining == 0) {
+        bool mated = moves.Size() == 0 && !attacking && position.IsInCheck();
+        Store(key, remaining, mated ? 0 : kInfinity, mated ? kInfinity : 0,
+              ChessMove(), 0, 1);
+        return;
+    }
+
+    // The attacker's last move has to give check to mate, so the others are
+    // dropped here rather than each expanded to find that out.
+    uint64_t      child_keys[kMaxMoves];
+    ChessMoveList candidates;
+    for (int i = 0; i < moves.Size(); ++i) {
+        position.MakeMove(moves[i]);
+        if (remaining > 1 || position.IsInCheck()) {
+            child_keys[candidates.Size()] = position.GetKey();
+            candidates.Add(moves[i]);
+        }
+        position.UnmakeMove(moves[i]);
+    }
+    if (candidates.Size() == 0) {
+        Store(key, remaining, kInfinity, 0, ChessMove(), 0, 1);
+        return;
+    }
+    moves = candidates;
+
+    for (;;) {
+        uint32_t phi = kInfinity, second = kInfinity, delta = 0;
+        uint32_t best_phi = 0;
+        int      best     = 0;
+
+        // Children nobody has looked at yet count as one of each.
+        for (int i = 0; i < moves.Size(); ++i) {
+            uint32_t     child_phi = 1, child_delta = 1;
+            const Entry *entry     = Lookup(child_keys[i], remaining - 1);
+            if (entry) {
+                child_phi   = attacking ? entry->disproof : entry->proof;
+                child_delta = attacking ? entry->proof : entry->disproof;
+            }
+
+            delta = AddNumbers(delta, child_phi);
+            if (child_delta < phi) {
+                second   = phi;
+                phi      = child_delta;
+                best     = i;
+                best_phi = child_phi;
+            } else if (child_delta < second) {
+                second = child_delta;
+            }
+        }
+
+        if (phi >= phi_threshold || delta >= delta_threshold || stopped) {
+            uint32_t  proof    = attacking ? phi : delta;
+            uint32_t  disproof = attacking ? delta : phi;
+            ChessMove move     = moves[best];
+            int       plies    = 0;
+
+            // A proven attacker takes the quickest mate, a proven defender
+            // the longest way into it; every child of the latter is proven.
+            if (proof == 0) {
+                plies = attacking ? kMaxMateMoves * 2 : 0;
+                for (int i = 0; i < moves.Size(); ++i) {
+                    const Entry *entry = Lookup(child_keys[i], remaining - 1);
+                    if (!entry || entry->proof != 0)
+                        continue;
+                    if (attacking ? entry->plies + 1 < plies
+                                  : entry->plies + 1 > plies) {
+                        plies = entry->plies + 1;
+                        move  = moves[i];
+                    }
+                }
+            }
+
+            Store(key, remaining, proof, disproof, move, plies,
+                  nodes - start_nodes);
+            return;
+        }
+
+        // The child may use up what is left of this position's delta
+        // budget, and must give way once it is no longer the most proving.
+        uint32_t child_phi_threshold =
+            delta_threshold >= kInfinity
+                ? kInfinity
+                : delta_threshold - delta + best_phi;
+        uint32_t child_delta_threshold =
+            phi_threshold < second + 1 ? phi_threshold : second + 1;
+
+        position.MakeMove(moves[best]);
+        Mid(position, remaining - 1, child_phi_threshold,
+            child_delta_threshold);
+        position.UnmakeMove(moves[best]);
+        ShouldStop();
+    }
+}
+
+bool MateSolver::Prove(ChessPosition &position, int remaining)
+{
+    Mid(position, remaining, kInfinity, kInfinity);
+    const Entry *entry = Lookup(position.GetKey(), remaining);
+    return entry && entry->proof == 0;
+}
+
+// Follows the moves stored with the proof. Entries replaced since are
+// proven again, which only searches the part of the proof that is missing.
+void MateSolver::ReadMainLine(ChessPosition &position, int remaining,
+                              std::vector<ChessMove> &line)
+{
+    const Entry *entry = Lookup(position.GetKey(), remaining);
+    if (!entry || entry->proof != 0) {
+        if (!Prove(position, remaining))
+            return;
+        entry = Lookup(position.GetKey(), remaining);
+    }
+    if (entry->plies == 0)
+        return;
+
+    ChessMove     move = ChessMove::FromRaw(entry->move);
+    ChessMoveList moves;
+    position.GenerateLegalMoves(moves);
+    bool legal = false;
+    for (int i = 0; i < moves.Size(); ++i)
+        legal = legal || moves[i] == move;
+    if (!legal)
+        return;
+
+    line.push_back(move);
+    position.MakeMove(move);
+    ReadMainLine(position, remaining - 1, line);
+    position.UnmakeMove(move);
+}
+
+// Called only as children return, while `nodes` counts every position
+// entered, so the clock is read once at least 1024 nodes have gone by.
+bool MateSolver::ShouldStop()
+{
+    if (limits.nodes && nodes >= limits.nodes) {
+        stopped = true;
+    } else if (limits.time_ms && nodes >= next_time_check) {
+        next_time_check = nodes + 1024;
+        if (ChessStats::NowNs() - start_ns >= limits.time_ms * 1000000)
+            stopped = true;
+    }
+    return stopped;
+}
+
+MateResult MateSolver::Solve(ChessPosition &position, const MateLimits &limits)
+{
+    MateResult result;
+
+    this->limits    = limits;
+    attacker        = position.GetSideToMove();
+    start_ns        = ChessStats::NowNs();
+    nodes           = 0;
+    next_time_check = 1024;
+    stopped         = false;
+    if (!clusters)
+        return result;
+
+    int max_moves = limits.moves < kMaxMateMoves ? limits.moves
+                                                 : kMaxMateMoves;
+    for (int moves = 1; moves <= max_moves; ++moves) {
+        int remaining = moves * 2 - 1;
+        Mid(position, remaining, kInfinity, kInfinity);
+        if (stopped)
+            break;
+
+        const Entry *entry = Lookup(position.GetKey(), remaining);
+        if (entry && entry->proof == 0) {
+            result.outcome = MateResult::Mate;
+            result.moves   = (entry->plies + 1) / 2;
+            break;
+        }
+    }
+    if (!stopped && result.outcome == MateResult::Unknown)
+        result.outcome = MateResult::NoMate;
+
+    // Reading the line re-proves whatever the table lost since, which a
+    // small table could keep doing for long. It gets as much work again as
+    // the proof took, within the caller's limits, and is cut short where
+    // it runs out.
+    if (result.outcome == MateResult::Mate) {
+        uint64_t budget = nodes * 2 + 1024;
+        if (!this->limits.nodes || this->limits.nodes > budget)
+            this->limits.nodes = budget;
+        ReadMainLine(position, result.moves * 2 - 1, result.main_line);
+    }
+
+    result.nodes   = nodes;
+    result.time_us = (ChessStats::NowNs() - start_ns) / 1000;
+    ChessStats::Increment(ChessStats::SearchNodes, nodes);
+    return result;
+}
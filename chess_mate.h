@@ -0,0 +1,107 @@
+#ifndef CHESS_MATE_H
+#define CHESS_MATE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "chess_position.h"
+
+const int kMaxMateMoves = 64;
+
+struct MateLimits {
+    int      moves   = 1; // prove a mate in at most this many moves
+    uint64_t nodes   = 0; // 0 means no node limit
+    uint64_t time_ms = 0; // 0 means no time limit
+};
+
+struct MateResult {
+    enum Outcome { Unknown, Mate, NoMate };
+
+    Outcome                outcome = Unknown;
+    int                    moves   = 0; // shortest forced mate, in moves
+    std::vector<ChessMove> main_line; // cut short if re-proving runs out
+    uint64_t               nodes   = 0; // positions expanded
+    uint64_t               time_us = 0;
+
+    uint64_t NodesPerSecond() const
+    {
+        return time_us ? nodes * 1000000 / time_us : 0;
+    }
+};
+
+// Proves or refutes a forced mate for the side to move with depth-first
+// proof-number search (df-pn). Every position has a proof number and a
+// disproof number: how many positions would at least have to be solved to
+// show there is a mate or that there is none. The search always expands
+// the most-proving position and only backs up when a number crosses its
+// threshold, so it needs no tree in memory. What it learns is kept in a
+// fixed-size table keyed by position and remaining depth, which also
+// merges transpositions; when the table is full the entries with the least
+// work behind them are replaced. A table much too small for the proof
+// makes the search go over the same ground again and again, so only the
+// limits may end it.
+//
+// Mates in 1, 2, ... moves are tried in turn, so a mate found is the
+// shortest. The main line follows the quickest mate the proof shows and
+// the longest defence against it. Draws by repetition or by the fifty-move
+// rule are not claimed on the way.
+class MateSolver {
+public:
+    MateSolver() = default;
+
+    MateSolver(const MateSolver &)            = delete;
+    MateSolver &operator=(const MateSolver &) = delete;
+
+    // Reallocates the table for `megabytes` (at least one cluster) and
+    // clears it.
+    bool Resize(size_t megabytes);
+    void Clear();
+
+    MateResult Solve(ChessPosition &position, const MateLimits &limits);
+
+private:
+    // Numbers are for the side that is trying to mate. `plies` is the
+    // length of the proof once proven, and `move` the move it goes on with.
+    struct Entry {
+        uint64_t key;
+        uint32_t proof;
+        uint32_t disproof;
+        uint32_t work; // positions expanded below this one; 0 when empty
+        uint32_t move;
+        uint8_t  remaining;
+        uint8_t  plies;
+        uint8_t  padding[6];
+    };
+
+    static const int kClusterEntries = 4;
+
+    struct alignas(64) Cluster {
+        Entry entries[kClusterEntries];
+    };
+    static_assert(sizeof(Cluster) == 128, "a cluster is two cache lines");
+
+    std::unique_ptr<Cluster[]> clusters;
+    uint64_t                   cluster_count = 0;
+
+    MateLimits limits;
+    TeamID     attacker;
+    uint64_t   start_ns;
+    uint64_t   nodes;
+    uint64_t   next_time_check;
+    bool       stopped;
+
+    const Entry *Lookup(uint64_t key, int remaining) const;
+    void Store(uint64_t key, int remaining, uint32_t proof, uint32_t disproof,
+               const ChessMove &move, int plies, uint64_t work);
+
+    void Mid(ChessPosition &position, int remaining, uint32_t phi_threshold,
+             uint32_t delta_threshold);
+    bool Prove(ChessPosition &position, int remaining);
+    void ReadMainLine(ChessPosition &position, int remaining,
+                      std::vector<ChessMove> &line);
+    bool ShouldStop();
+};
+
+#endif
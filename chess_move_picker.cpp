@@ -0,0 +1,122 @@
+#include "chess_move_picker.h"
+#include "chess_eval.h"
+
+MovePicker::MovePicker(const ChessPosition &position,
+                       const ChessMove &hash_move, const ChessMove *killers,
+                       bool noisy_only)
+    : position(position), hash_move(hash_move), noisy_only(noisy_only)
+{
+    if (killers) {
+        this->killers[0] = killers[0];
+        this->killers[1] = killers[1];
+    }
+}
+
+bool MovePicker::IsLegal(const ChessMove &move)
+{
+    if (!have_info) {
+        position.ComputeCheckInfo(info);
+        have_info = true;
+    }
+    return position.IsLegal(move, info);
+}
+
+// Most valuable victim first, then least valuable attacker; promotions
+// count as capturing what the pawn becomes.
+void MovePicker::ScoreCaptures()
+{
+    for (int i = 0; i < moves.Size(); ++i) {
+        const ChessMove &move = moves[i];
+
+        int victim   = move.IsCapture()
+                           ? kPieceValues[PieceCodeID(move.GetCaptured())]
+                           : 0;
+        int promoted = move.GetPromotion()
+                           ? kPieceValues[PieceCodeID(move.GetPromotion())]
+                           : 0;
+        scores[i] = (victim + promoted) * 8 - PieceCodeID(move.GetPiece());
+    }
+}
+
+// Brings the highest scored remaining capture to `index`; captures tend to
+// be few and the first one often cuts off, so this beats sorting.
+void MovePicker::PickBest()
+{
+    int best = index;
+    for (int i = index + 1; i < moves.Size(); ++i)
+        if (scores[i] > scores[best])
+            best = i;
+
+    if (best != index) {
+        ChessMove move = moves[index];
+        moves[index]   = moves[best];
+        moves[best]    = move;
+
+        int score     = scores[index];
+        scores[index] = scores[best];
+        scores[best]  = score;
+    }
+}
+
+ChessMove MovePicker::Next()
+{
+    for (;;) {
+        switch (stage) {
+        case HashMove:
+            stage = GenerateCaptures;
+            // The move may come from another position with the same table
+            // slot, so it is checked against this one first.
+            if (!hash_move.IsNull() && (!noisy_only || !hash_move.IsQuiet()) &&
+                position.IsPseudoLegal(hash_move) && IsLegal(hash_move))
+                return hash_move;
+            break;
+
+        case GenerateCaptures:
+            position.GenerateCaptures(moves);
+            ScoreCaptures();
+            index = 0;
+            stage = Captures;
+            break;
+
+        case Captures:
+            while (index < moves.Size()) {
+                PickBest();
+                ChessMove move = moves[index++];
+                if (move != hash_move && IsLegal(move))
+                    return move;
+            }
+            stage = noisy_only ? Done : Killers;
+            index = 0;
+            break;
+
+        case Killers:
+            while (index < 2) {
+                ChessMove move = killers[index++];
+                if (!move.IsNull() && move != hash_move && move.IsQuiet() &&
+                    position.IsPseudoLegal(move) && IsLegal(move))
+                    return move;
+            }
+            stage = GenerateQuiets;
+            break;
+
+        case GenerateQuiets:
+            position.GenerateQuiets(moves);
+            index = 0;
+            stage = Quiets;
+            break;
+
+        case Quiets:
+            while (index < moves.Size()) {
+                ChessMove move = moves[index++];
+                if (move != hash_move && move != killers[0] &&
+                    move != killers[1] && IsLegal(move))
+                    return move;
+            }
+            stage = Done;
+            break;
+
+        case Done:
+            return ChessMove();
+        }
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef CHESS_MOVE_PICKER_H
+#define CHESS_MOVE_PICKER_H
+
+#include "chess_position.h"
+
+// Hands out the legal moves of a position one at a time in the order most
+// likely to cut off: the hash move, captures and promotions by most
+// valuable victim and least valuable attacker, the killers, then the other
+// quiet moves. Each stage is generated only once the one before runs out,
+// so a cutoff on the hash move generates nothing at all.
+//
+// Moves are checked for legality one by one as they are handed out. The
+// lists live inside the picker, which belongs on the caller's stack.
+class MovePicker {
+public:
+    // `killers` may be null. With `noisy_only` the picker stops after the
+    // captures and promotions, as quiescence search wants.
+    MovePicker(const ChessPosition &position, const ChessMove &hash_move,
+               const ChessMove *killers, bool noisy_only = false);
+
+    MovePicker(const MovePicker &)            = delete;
+    MovePicker &operator=(const MovePicker &) = delete;
+
+    // A null move once there are none left.
+    ChessMove Next();
+
+private:
+    enum Stage {
+        HashMove,
+        GenerateCaptures,
+        Captures,
+        Killers,
+        GenerateQuiets,
+        Quiets,
+        Done
+    };
+
+    const ChessPosition &position;
+    ChessMove            hash_move;
+    ChessMove            killers[2];
+    bool                 noisy_only;
+    Stage                stage = HashMove;
+    int                  index = 0;
+
+    // Computed for the first move that needs a legality check.
+    bool      have_info = false;
+    CheckInfo info;
+
+    ChessMoveList moves;
+    int           scores[kMaxMoves];
+
+    bool IsLegal(const ChessMove &move);
+    void ScoreCaptures();
+    void PickBest();
+};
+
+#endif
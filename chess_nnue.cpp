@@ -0,0 +1,451 @@
+#include "chess_nnue.h"
+#include "chess_cache_file.h"
+#include "chess_eval.h"
+#include "chess_position.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <immintrin.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+const uint32_t kNnueVersion = 1;
+const int      kInputSize   = 2 * kNnueHalfDimensions;
+// Hidden layer sums are scaled down by 2^6 before clipping, the output by
+// 16 to get centipawns.
+const int kWeightShift = 6;
+const int kOutputScale = 16;
+
+struct NnueHeader {
+    char     magic[4]; // "CHNN"
+    uint32_t version;
+    uint32_t features;
+    uint32_t half_dimensions;
+    uint32_t hidden;
+    uint32_t reserved[11];
+};
+
+static_assert(sizeof(NnueHeader) == 64, "header must stay 64 bytes");
+
+// Byte offsets of every array in the file, each aligned to 64 bytes.
+struct NnueLayout {
+    size_t feature_biases, feature_weights;
+    size_t hidden1_biases, hidden1_weights;
+    size_t hidden2_biases, hidden2_weights;
+    size_t output_bias, output_weights;
+    size_t size;
+
+    NnueLayout()
+    {
+        size = sizeof(NnueHeader);
+        feature_biases  = Place(kNnueHalfDimensions * sizeof(int16_t));
+        feature_weights = Place(size_t(kNnueFeatures) * kNnueHalfDimensions *
+                                sizeof(int16_t));
+        hidden1_biases  = Place(kNnueHidden * sizeof(int32_t));
+        hidden1_weights = Place(kNnueHidden * kInputSize);
+        hidden2_biases  = Place(kNnueHidden * sizeof(int32_t));
+        hidden2_weights = Place(kNnueHidden * kNnueHidden);
+        output_bias     = Place(sizeof(int32_t));
+        output_weights  = Place(kNnueHidden);
+    }
+
+private:
+    size_t Place(size_t bytes)
+    {
+        size_t offset = size;
+        size          = (size + bytes + 63) & ~size_t(63);
+        return offset;
+    }
+};
+
+static const NnueLayout kLayout;
+
+static int FeatureIndex(TeamID perspective, int king_square, int piece,
+                        int square)
+{
+    // Black sees the board flipped, with its own pieces as the "own" ones.
+    int flip = perspective == TeamID::White ? 0 : 56;
+    int own  = PieceCodeTeam(piece) == perspective ? 0 : 1;
+    return (((king_square ^ flip) * 5 + PieceCodeID(piece)) * 2 + own) * 64 +
+           (square ^ flip);
+}
+
+static uint8_t ClippedRelu(int32_t sum)
+{
+    sum >>= kWeightShift;
+    return sum < 0 ? 0 : sum > 127 ? 127 : sum;
+}
+
+// Scalar kernels.
+
+static void ApplyScalar(int16_t *values, const int16_t *const *added,
+                        int added_count, const int16_t *const *removed,
+                        int removed_count)
+{
+    for (int i = 0; i < kNnueHalfDimensions; ++i) {
+        int value = values[i];
+        for (int a = 0; a < added_count; ++a)
+            value += added[a][i];
+        for (int r = 0; r < removed_count; ++r)
+            value -= removed[r][i];
+        values[i] = value;
+    }
+}
+
+static void TransformScalar(const int16_t *values, uint8_t *out)
+{
+    for (int i = 0; i < kNnueHalfDimensions; ++i)
+        out[i] = values[i] < 0 ? 0 : values[i] > 127 ? 127 : values[i];
+}
+
+static int32_t DotScalar(const uint8_t *input, const int8_t *weights, int size)
+{
+    int32_t sum = 0;
+    for (int i = 0; i < size; ++i)
+        sum += input[i] * weights[i];
+    return sum;
+}
+
+// A dense layer followed by the clipped ReLU; weights are one row of
+// `in_size` per output.
+static void AffineScalar(const uint8_t *input, int in_size,
+                         const int8_t *weights, const int32_t *biases,
+                         uint8_t *output, int out_size)
+{
+    for (int i = 0; i < out_size; ++i)
+        output[i] = ClippedRelu(biases[i] +
+                                DotScalar(input, weights + i * in_size,
+                                          in_size));
+}
+
+// AVX2 kernels, compiled for AVX2 regardless of the build flags and only
+// called when the CPU reports it.
+
+__attribute__((target("avx2"))) static void
+ApplyAvx2(int16_t *values, const int16_t *const *added, int added_count,
+          const int16_t *const *removed, int removed_count)
+{
+    for (int i = 0; i < kNnueHalfDimensions; i += 16) {
+        __m256i *chunk = reinterpret_cast<__m256i *>(values + i);
+        __m256i  value = _mm256_load_si256(chunk);
+        for (int a = 0; a < added_count; ++a)
+            value = _mm256_add_epi16(
+                value, _mm256_loadu_si256(
+                           reinterpret_cast<const __m256i *>(added[a] + i)));
+        for (int r = 0; r < removed_count; ++r)
+            value = _mm256_sub_epi16(
+                value, _mm256_loadu_si256(
+                           reinterpret_cast<const __m256i *>(removed[r] + i)));
+        _mm256_store_si256(chunk, value);
+    }
+}
+
+__attribute__((target("avx2"))) static void
+TransformAvx2(const int16_t *values, uint8_t *out)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    for (int i = 0; i < kNnueHalfDimensions; i += 32) {
+        __m256i low = _mm256_load_si256(
+            reinterpret_cast<const __m256i *>(values + i));
+        __m256i high = _mm256_load_si256(
+            reinterpret_cast<const __m256i *>(values + i + 16));
+        // Saturating to int8 clips at 127; packing interleaves the two
+        // 128-bit lanes, which the permute undoes.
+        __m256i packed = _mm256_max_epi8(_mm256_packs_epi16(low, high), zero);
+        packed         = _mm256_permute4x64_epi64(packed, 0xD8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), packed);
+    }
+}
+
+__attribute__((target("avx2"))) static int32_t
+DotAvx2(const uint8_t *input, const int8_t *weights, int size)
+{
+    const __m256i ones = _mm256_set1_epi16(1);
+    __m256i       sum  = _mm256_setzero_si256();
+
+    // Inputs are at most 127, so the pairwise int16 sums cannot saturate.
+    for (int i = 0; i < size; i += 32) {
+        __m256i x = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i *>(input + i));
+        __m256i w = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i *>(weights + i));
+        sum = _mm256_add_epi32(
+            sum, _mm256_madd_epi16(_mm256_maddubs_epi16(x, w), ones));
+    }
+
+    __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum),
+                                 _mm256_extracti128_si256(sum, 1));
+    half         = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0x4E));
+    half         = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0xB1));
+    return _mm_cvtsi128_si32(half);
+}
+
+// Four outputs at a time, so each input chunk is loaded once for all of
+// them and the four sums are reduced together.
+__attribute__((target("avx2"))) static void
+AffineAvx2(const uint8_t *input, int in_size, const int8_t *weights,
+           const int32_t *biases, uint8_t *output, int out_size)
+{
+    const __m256i ones = _mm256_set1_epi16(1);
+
+    for (int i = 0; i < out_size; i += 4) {
+        const int8_t *rows[4];
+        __m256i       sums[4];
+        for (int k = 0; k < 4; ++k) {
+            rows[k] = weights + (i + k) * in_size;
+            sums[k] = _mm256_setzero_si256();
+        }
+
+        for (int j = 0; j < in_size; j += 32) {
+            __m256i x = _mm256_loadu_si256(
+                reinterpret_cast<const __m256i *>(input + j));
+            for (int k = 0; k < 4; ++k) {
+                __m256i w = _mm256_loadu_si256(
+                    reinterpret_cast<const __m256i *>(rows[k] + j));
+                sums[k] = _mm256_add_epi32(
+                    sums[k],
+                    _mm256_madd_epi16(_mm256_maddubs_epi16(x, w), ones));
+            }
+        }
+
+        __m256i pairs = _mm256_hadd_epi32(_mm256_hadd_epi32(sums[0], sums[1]),
+                                          _mm256_hadd_epi32(sums[2], sums[3]));
+        __m128i sum   = _mm_add_epi32(_mm256_castsi256_si128(pairs),
+                                      _mm256_extracti128_si256(pairs, 1));
+        sum = _mm_add_epi32(sum, _mm_loadu_si128(
+                                     reinterpret_cast<const __m128i *>(
+                                         biases + i)));
+        sum = _mm_srai_epi32(sum, kWeightShift);
+
+        // Saturating packs clip to 0..127 once negatives are zeroed.
+        sum = _mm_max_epi32(sum, _mm_setzero_si128());
+        sum = _mm_packs_epi32(sum, sum);
+        sum = _mm_packs_epi16(sum, sum);
+        *reinterpret_cast<int32_t *>(output + i) = _mm_cvtsi128_si32(sum);
+    }
+}
+
+NnueNetwork::~NnueNetwork()
+{
+    if (mapping)
+        munmap(mapping, mapping_size);
+}
+
+bool NnueNetwork::Load(const char *path)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    void       *data = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && size_t(st.st_size) == kLayout.size)
+        data = mmap(nullptr, kLayout.size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        return false;
+
+    const NnueHeader *header = static_cast<const NnueHeader *>(data);
+    if (memcmp(header->magic, "CHNN", 4) || header->version != kNnueVersion ||
+        header->features != kNnueFeatures ||
+        header->half_dimensions != kNnueHalfDimensions ||
+        header->hidden != kNnueHidden) {
+        munmap(data, kLayout.size);
+        return false;
+    }
+
+    if (mapping)
+        munmap(mapping, mapping_size);
+    mapping      = data;
+    mapping_size = kLayout.size;
+    fingerprint  = HashBytes(data, kLayout.size);
+
+    const char *base = static_cast<const char *>(data);
+    feature_biases =
+        reinterpret_cast<const int16_t *>(base + kLayout.feature_biases);
+    feature_weights =
+        reinterpret_cast<const int16_t *>(base + kLayout.feature_weights);
+    hidden1_biases =
+        reinterpret_cast<const int32_t *>(base + kLayout.hidden1_biases);
+    hidden1_weights =
+        reinterpret_cast<const int8_t *>(base + kLayout.hidden1_weights);
+    hidden2_biases =
+        reinterpret_cast<const int32_t *>(base + kLayout.hidden2_biases);
+    hidden2_weights =
+        reinterpret_cast<const int8_t *>(base + kLayout.hidden2_weights);
+    output_bias = reinterpret_cast<const int32_t *>(base + kLayout.output_bias);
+    output_weights =
+        reinterpret_cast<const int8_t *>(base + kLayout.output_weights);
+
+    SetAvx2(true);
+    return true;
+}
+
+void NnueNetwork::SetAvx2(bool enable)
+{
+    use_avx2 = enable && __builtin_cpu_supports("avx2");
+}
+
+void NnueNetwork::Refresh(const ChessPosition &position, TeamID perspective,
+                          NnueAccumulator &accumulator) const
+{
+    const int16_t *features[32];
+    int            count       = 0;
+    int            king_square = position.GetKingSquare(perspective);
+
+    for (int square = 0; square < 64 && count < 32; ++square) {
+        PieceCode piece = position.GetPiece(square);
+        if (piece && PieceCodeID(piece) != ChessPiece::King)
+            features[count++] =
+                feature_weights +
+                size_t(FeatureIndex(perspective, king_square, piece, square)) *
+                    kNnueHalfDimensions;
+    }
+
+    int16_t *values = accumulator.values[static_cast<int>(perspective)];
+    memcpy(values, feature_biases, kNnueHalfDimensions * sizeof(int16_t));
+    if (use_avx2)
+        ApplyAvx2(values, features, count, nullptr, 0);
+    else
+        ApplyScalar(values, features, count, nullptr, 0);
+}
+
+void NnueNetwork::Update(NnueAccumulator &accumulator, TeamID perspective,
+                         int king_square, const NnueDelta &delta) const
+{
+    const int16_t *added[2], *removed[2];
+
+    for (int i = 0; i < delta.added; ++i)
+        added[i] = feature_weights +
+                   size_t(FeatureIndex(perspective, king_square,
+                                       delta.added_piece[i],
+                                       delta.added_square[i])) *
+                       kNnueHalfDimensions;
+    for (int i = 0; i < delta.removed; ++i)
+        removed[i] = feature_weights +
+                     size_t(FeatureIndex(perspective, king_square,
+                                         delta.removed_piece[i],
+                                         delta.removed_square[i])) *
+                         kNnueHalfDimensions;
+
+    int16_t *values = accumulator.values[static_cast<int>(perspective)];
+    if (use_avx2)
+        ApplyAvx2(values, added, delta.added, removed, delta.removed);
+    else
+        ApplyScalar(values, added, delta.added, removed, delta.removed);
+}
+
+int NnueNetwork::Evaluate(const NnueAccumulator &accumulator,
+                          TeamID                 side) const
+{
+    alignas(32) uint8_t input[kInputSize];
+    alignas(32) uint8_t hidden1[kNnueHidden];
+    alignas(32) uint8_t hidden2[kNnueHidden];
+
+    const int16_t *us   = accumulator.values[static_cast<int>(side)];
+    const int16_t *them = accumulator.values[static_cast<int>(OtherTeam(side))];
+
+    if (use_avx2) {
+        TransformAvx2(us, input);
+        TransformAvx2(them, input + kNnueHalfDimensions);
+        AffineAvx2(input, kInputSize, hidden1_weights, hidden1_biases, hidden1,
+                   kNnueHidden);
+        AffineAvx2(hidden1, kNnueHidden, hidden2_weights, hidden2_biases,
+                   hidden2, kNnueHidden);
+        return (*output_bias + DotAvx2(hidden2, output_weights, kNnueHidden)) /
+               kOutputScale;
+    }
+
+    TransformScalar(us, input);
+    TransformScalar(them, input + kNnueHalfDimensions);
+    AffineScalar(input, kInputSize, hidden1_weights, hidden1_biases, hidden1,
+                 kNnueHidden);
+    AffineScalar(hidden1, kNnueHidden, hidden2_weights, hidden2_biases,
+                 hidden2, kNnueHidden);
+    return (*output_bias + DotScalar(hidden2, output_weights, kNnueHidden)) /
+           kOutputScale;
+}
+
+// The network is built by hand:
+//  - each feature adds its piece-square value, in units of 4 cp, spread
+//    over four accumulator cells of a (own/enemy, piece, file pair) group,
+//    so no cell leaves the linear 0..127 range in a normal game;
+//  - the first hidden layer sums own minus enemy cells of the side to move
+//    into 16 cells, each covering a 127-unit slice of +-1016 units;
+//  - the second layer copies them and the output adds them back up.
+bool NnueNetwork::WriteFromClassical(const char *path)
+{
+    const int kParts   = 4;
+    const int kUnit    = 4;
+    const int kSlices  = 16;
+    const int kRange   = kSlices * 127 / 2;
+    const int kOwnSize = 5 * 4 * kParts;
+
+    std::vector<char> file(kLayout.size, 0);
+    char             *base = file.data();
+
+    NnueHeader *header = reinterpret_cast<NnueHeader *>(base);
+    memcpy(header->magic, "CHNN", 4);
+    header->version         = kNnueVersion;
+    header->features        = kNnueFeatures;
+    header->half_dimensions = kNnueHalfDimensions;
+    header->hidden          = kNnueHidden;
+
+    int16_t *feature_weights =
+        reinterpret_cast<int16_t *>(base + kLayout.feature_weights);
+    for (int king = 0; king < 64; ++king) {
+        for (int id = ChessPiece::Pawn; id <= ChessPiece::Queen; ++id) {
+            for (int own = 0; own < 2; ++own) {
+                for (int square = 0; square < 64; ++square) {
+                    auto pid   = static_cast<ChessPiece::PieceID>(id);
+                    int  value = PieceSquareValue(pid, own ? square ^ 56
+                                                           : square);
+                    int  units = (value + kUnit / 2) / kUnit;
+                    int  group = (own * 5 + id) * 4 + SquareX(square) / 2;
+
+                    int16_t *weights =
+                        feature_weights +
+                        size_t(((king * 5 + id) * 2 + own) * 64 + square) *
+                            kNnueHalfDimensions +
+                        group * kParts;
+                    for (int part = 0; part < kParts; ++part)
+                        weights[part] =
+                            units / kParts + (part < units % kParts);
+                }
+            }
+        }
+    }
+
+    int32_t *hidden1_biases =
+        reinterpret_cast<int32_t *>(base + kLayout.hidden1_biases);
+    int8_t *hidden1_weights =
+        reinterpret_cast<int8_t *>(base + kLayout.hidden1_weights);
+    int32_t *hidden2_biases =
+        reinterpret_cast<int32_t *>(base + kLayout.hidden2_biases);
+    int8_t *hidden2_weights =
+        reinterpret_cast<int8_t *>(base + kLayout.hidden2_weights);
+    int8_t *output_weights =
+        reinterpret_cast<int8_t *>(base + kLayout.output_weights);
+
+    for (int slice = 0; slice < kSlices; ++slice) {
+        for (int cell = 0; cell < 2 * kOwnSize; ++cell)
+            hidden1_weights[slice * kInputSize + cell] =
+                cell < kOwnSize ? 1 << kWeightShift : -(1 << kWeightShift);
+        hidden1_biases[slice] = (kRange - 127 * slice) << kWeightShift;
+
+        hidden2_weights[slice * kNnueHidden + slice] = 1 << kWeightShift;
+        hidden2_biases[slice]                        = 0;
+        output_weights[slice] = kUnit * kOutputScale;
+    }
+    *reinterpret_cast<int32_t *>(base + kLayout.output_bias) =
+        -kRange * kUnit * kOutputScale;
+
+    FILE *out = fopen(path, "wb");
+    if (!out)
+        return false;
+    bool success = fwrite(base, 1, file.size(), out) == file.size();
+    return fclose(out) == 0 && success;
+}
@@ -0,0 +1,94 @@
+#ifndef CHESS_NNUE_H
+#define CHESS_NNUE_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "chess_pieces.h"
+
+class ChessPosition;
+
+// HalfKP network: for each side, every non-king piece is a feature indexed
+// by (own king square, piece, square), seen from that side (black's board
+// is flipped). The first layer is kept per position as an accumulator and
+// updated with the few features a move changes; the rest is
+// 2x256 -> 32 -> 32 -> 1 with clipped ReLU, int8 weights and int32 sums.
+const int kNnueFeatures       = 64 * 10 * 64;
+const int kNnueHalfDimensions = 256;
+const int kNnueHidden         = 32;
+
+struct alignas(32) NnueAccumulator {
+    int16_t values[2][kNnueHalfDimensions]; // indexed by TeamID
+};
+
+// Pieces a move takes off and puts on the board; piece codes as in
+// chess_position.h, kings never appear.
+struct NnueDelta {
+    int removed = 0;
+    int added   = 0;
+    int removed_piece[2], removed_square[2];
+    int added_piece[2], added_square[2];
+
+    void Remove(int piece, int square)
+    {
+        removed_piece[removed]    = piece;
+        removed_square[removed++] = square;
+    }
+    void Add(int piece, int square)
+    {
+        added_piece[added]    = piece;
+        added_square[added++] = square;
+    }
+};
+
+// Weights are used straight from a read-only mapping of the network file,
+// so processes loading the same file share one copy in the page cache.
+// The file is little-endian: a 64-byte header, then each array in the
+// order below, each starting on a 64-byte boundary.
+class NnueNetwork {
+public:
+    NnueNetwork() = default;
+    ~NnueNetwork();
+
+    NnueNetwork(const NnueNetwork &)            = delete;
+    NnueNetwork &operator=(const NnueNetwork &) = delete;
+
+    bool Load(const char *path);
+    bool IsLoaded() const { return mapping != nullptr; }
+    // Hash of the whole file, to tell networks apart.
+    uint64_t GetFingerprint() const { return fingerprint; }
+
+    // AVX2 is used when the CPU has it; turning it off forces the scalar
+    // kernels, which compute the same results.
+    void SetAvx2(bool enable);
+    bool UsesAvx2() const { return use_avx2; }
+
+    void Refresh(const ChessPosition &position, TeamID perspective,
+                 NnueAccumulator &accumulator) const;
+    void Update(NnueAccumulator &accumulator, TeamID perspective,
+                int king_square, const NnueDelta &delta) const;
+    // Centipawns from the side to move's point of view.
+    int Evaluate(const NnueAccumulator &accumulator, TeamID side) const;
+
+    // Writes a network that reproduces the classical material and
+    // piece-square terms (all but the king's), to have a valid file without
+    // a trainer.
+    static bool WriteFromClassical(const char *path);
+
+private:
+    void    *mapping = nullptr;
+    size_t   mapping_size;
+    uint64_t fingerprint = 0;
+    bool     use_avx2    = false;
+
+    const int16_t *feature_biases;
+    const int16_t *feature_weights;
+    const int32_t *hidden1_biases;
+    const int8_t  *hidden1_weights;
+    const int32_t *hidden2_biases;
+    const int8_t  *hidden2_weights;
+    const int32_t *output_bias;
+    const int8_t  *output_weights;
+};
+
+#endif
@@ -1,5 +1,6 @@
 #include "chess_pieces.h"
 #include "chess_board.h"
+#include "chess_history.h"
 
 #include <cstdlib>
 #include <ncurses.h>
@@ -9,34 +10,28 @@
 extern Log gLog;
 #endif
 
-TurnInfo::TurnInfo()
-{
-    src_x  = -1;
-    src_y  = -1;
-    dest_x = -1;
-    dest_y = -1;
-    piece  = nullptr;
-}
-
-void TurnInfo::ChangeTurnInfo(int src_x, int src_y, int dest_x, int dest_y,
-                              ChessPiece *piece)
+ChessPiece::ChessPiece(PieceID pid, TeamID tid) : piece_id(pid), team_id(tid)
 {
-    this->src_x  = src_x;
-    this->src_y  = src_y;
-    this->dest_x = dest_x;
-    this->dest_y = dest_y;
-    this->piece  = piece;
+    color_pair_id = team_id == TeamID::White ? 1 : 3;
 }
 
-ChessPiece::ChessPiece(PieceID pid, TeamID tid) : piece_id(pid), team_id(tid)
+ChessPiece *ChessPiece::Create(PieceID pid, TeamID tid)
 {
-    color_pair_id = team_id == TeamID::White ? 1 : 3;
+    switch (pid) {
+    case Pawn: return new PawnPiece(tid);
+    case Knight: return new KnightPiece(tid);
+    case Bishop: return new BishopPiece(tid);
+    case Rook: return new RookPiece(tid);
+    case Queen: return new QueenPiece(tid);
+    default: return new KingPiece(tid);
+    }
 }
 
 PawnPiece::PawnPiece(TeamID tid) : ChessPiece(PieceID::Pawn, tid) {}
 
 bool PawnPiece::CanMovePiece(int curr_x, int curr_y, int dest_x, int dest_y,
-                             ChessPiece *board[8][8], TurnInfo &prev_turn)
+                             ChessPiece *board[8][8],
+                             const MoveHistory &history)
 {
     int success = false;
 #ifndef NDEBUG
@@ -56,20 +51,9 @@ bool PawnPiece::CanMovePiece(int curr_x, int curr_y, int dest_x, int dest_y,
 
             success = true;
 
-        } else if (CheckForEnPassant(prev_turn, dest_x)) {
-            if (distance_x == -1) {
-
-                delete board[curr_y][curr_x + 1];
-                board[curr_y][curr_x + 1] = nullptr;
-
-                success = true;
-            } else if (distance_x == 1) {
-
-                delete board[curr_y][curr_x - 1];
-                board[curr_y][curr_x - 1] = nullptr;
-
-                success = true;
-            }
+        } else if (distance_y == (team_id == TeamID::White ? 1 : -1) &&
+                   CheckForEnPassant(history, dest_x, dest_y)) {
+            success = true;
         }
     } else if (distance_x == 0) {
         if (team_id == TeamID::White && distance_y > 0 &&
@@ -86,10 +70,8 @@ bool PawnPiece::CanMovePiece(int curr_x, int curr_y, int dest_x, int dest_y,
         }
     }
 
-    if (success)
-        has_moved_before = true;
 #ifndef NDEBUG
-    else
+    if (!success)
         fprintf(gLog,
                 "%s: Pawn not moved from position (curr_x)[%d] (curr_y)[%d] to "
                 "(dest_x)[%d] (dest_y)[%d] (board[dest_y][dest_x])[%d]\n",
@@ -101,18 +83,17 @@ bool PawnPiece::CanMovePiece(int curr_x, int curr_y, int dest_x, int dest_y,
     return success;
 }
 
-bool PawnPiece::CheckForEnPassant(TurnInfo prev_turn, int dest_x)
+bool PawnPiece::CheckForEnPassant(const MoveHistory &history, int dest_x,
+                                  int dest_y) const
 {
-    ChessPiece *piece = prev_turn.GetPiece();
-    return piece && piece->GetPieceID() == PieceID::Pawn &&
-           (prev_turn.GetXDistance() == 2 || prev_turn.GetYDistance() == -2) &&
-           (prev_turn.GetDestinationX() == dest_x);
+    return history.EnPassantSquare() == SquareIndex(dest_x, dest_y);
 }
 
 KnightPiece::KnightPiece(TeamID tid) : ChessPiece(PieceID::Knight, tid) {}
 
 bool KnightPiece::CanMovePiece(int curr_x, int curr_y, int dest_x, int dest_y,
-                               ChessPiece *board[8][8], TurnInfo &prev_turn)
+                               ChessPiece *board[8][8],
+                               const MoveHistory &history)
 {
     bool success = false;
 
@@ -134,10 +115,8 @@ bool KnightPiece::CanMovePiece(int curr_x, int curr_y, int dest_x, int dest_y,
             success = true;
     }
 
-    if (success)
-        has_moved_before = true;
 #ifndef NDEBUG
-    else
+    if (!success)
         fprintf(
             gLog,
             "%s: Knight not moved from position (curr_x)[%d] (curr_y)[%d] to "
@@ -153,7 +132,8 @@ bool KnightPiece::CanMovePiece(int curr_x, int curr_y, int dest_x, int dest_y,
 BishopPiece::BishopPiece(TeamID tid) : ChessPiece(PieceID::Bishop, tid) {}
 
 bool BishopPiece::CanMovePiece(int curr_x, int curr_y, int dest_x, int dest_y,
-                               ChessPiece *board[8][8], TurnInfo &prev_turn)
+                               ChessPiece *board[8][8],
+                               const MoveHistory &history)
 {
     bool success = false;
 
@@ -195,10 +175,8 @@ bool BishopPiece::CanMovePiece(int curr_x, int curr_y, int dest_x, int dest_y,
         }
     }
 
-    if (success)
-        has_moved_before = true;
 #ifndef NDEBUG
-    else
+    if (!success)
         fprintf(
             gLog,
             "%s: Bishop not moved from position (curr_x)[%d] (curr_y)[%d] to "
@@ -214,7 +192,8 @@ bool BishopPiece::CanMovePiece(int curr_x, int curr_y, int dest_x, int dest_y,
 RookPiece::RookPiece(TeamID tid) : ChessPiece(PieceID::Rook, tid) {}
 
 bool RookPiece::CanMovePiece(int curr_x, int curr_y, int dest_x, int dest_y,
-                             ChessPiece *board[8][8], TurnInfo &prev_turn)
+                             ChessPiece *board[8][8],
+                             const MoveHistory &history)
 {
     bool success = false;
 
@@ -257,10 +236,8 @@ bool RookPiece::CanMovePiece(int curr_x, int curr_y, int dest_x, int dest_y,
         }
     }
 
-    if (success)
-        has_moved_before = true;
 #ifndef NDEBUG
-    else
+    if (!success)
         fprintf(gLog,
                 "%s: Rook not moved from position (curr_x)[%d] (curr_y)[%d] to "
                 "(dest_x)[%d] (dest_y)[%d] (board[dest_y][dest_x])[%d]\n",
@@ -275,7 +252,8 @@ bool RookPiece::CanMovePiece(int curr_x, int curr_y, int dest_x, int dest_y,
 QueenPiece::QueenPiece(TeamID tid) : ChessPiece(PieceID::Queen, tid) {}
 
 bool QueenPiece::CanMovePiece(int curr_x, int curr_y, int dest_x, int dest_y,
-                              ChessPiece *board[8][8], TurnInfo &prev_turn)
+                              ChessPiece *board[8][8],
+                              const MoveHistory &history)
 {
     bool success = false;
 
@@ -320,10 +298,8 @@ bool QueenPiece::CanMovePiece(int curr_x, int curr_y, int dest_x, int dest_y,
         }
     }
 
-    if (success)
-        has_moved_before = true;
 #ifndef NDEBUG
-    else
+    if (!success)
         fprintf(
             gLog,
             "%s: Queen not moved from position (curr_x)[%d] (curr_y)[%d] to "
@@ -339,7 +315,8 @@ bool QueenPiece::CanMovePiece(int curr_x, int curr_y, int dest_x, int dest_y,
 KingPiece::KingPiece(TeamID tid) : ChessPiece(PieceID::King, tid) {}
 
 bool KingPiece::CanMovePiece(int curr_x, int curr_y, int dest_x, int dest_y,
-                             ChessPiece *board[8][8], TurnInfo &prev_turn)
+                             ChessPiece *board[8][8],
+                             const MoveHistory &history)
 {
     bool success = false;
 
@@ -361,10 +338,8 @@ bool KingPiece::CanMovePiece(int curr_x, int curr_y, int dest_x, int dest_y,
         }
     }
 
-    if (success)
-        has_moved_before = true;
 #ifndef NDEBUG
-    else
+    if (!success)
         fprintf(gLog,
                 "%s: King not moved from position (curr_x)[%d] (curr_y)[%d] to "
                 "(dest_x)[%d] (dest_y)[%d] (board[dest_y][dest_x])[%d]\n",
@@ -8,27 +8,7 @@ enum class TeamID { White, Black };
 const char kPieceChars[] = {'p', 'N', 'B', 'R', 'Q', 'K'};
 
 class ChessPiece;
-
-class TurnInfo {
-    int         src_x, src_y;
-    int         dest_x, dest_y;
-    ChessPiece *piece;
-
-public:
-    TurnInfo();
-    ~TurnInfo() {}
-    void ChangeTurnInfo(int src_x, int src_y, int dest_x, int dest_y,
-                        ChessPiece *piece);
-
-    int GetXDistance() const { return src_x - dest_x; }
-    int GetYDistance() const { return src_y - dest_y; }
-    int GetSourceX() const { return src_x; }
-    int GetSourceY() const { return src_y; }
-    int GetDestinationX() const { return dest_x; }
-    int GetDestinationY() const { return dest_y; }
-
-    ChessPiece *GetPiece() const { return piece; }
-};
+class MoveHistory;
 
 class ChessPiece {
 public:
@@ -45,13 +25,21 @@ public:
     ChessPiece(PieceID pid, TeamID tid);
     virtual ~ChessPiece(){};
 
+    static ChessPiece *Create(PieceID pid, TeamID tid);
+
+    // Only checks the piece's movement pattern; it neither changes the
+    // board nor the piece, and knows nothing about check.
     virtual bool CanMovePiece(int curr_x, int curr_y, int dest_x, int dest_y,
-                              ChessPiece *board[8][8], TurnInfo &prev_turn) = 0;
+                              ChessPiece *board[8][8],
+                              const MoveHistory &history) = 0;
 
     PieceID GetPieceID() const { return piece_id; }
     TeamID  GetTeamID() const { return team_id; }
     char    GetColorPairID() const { return color_pair_id; }
     bool    HasMovedBefore() const { return has_moved_before; }
+    void    MarkMoved() { has_moved_before = true; }
+    // For taking moves back.
+    void    SetMoved(bool moved) { has_moved_before = moved; }
 
 protected:
     bool CanMoveTo(ChessPiece *dest) const
@@ -70,10 +58,12 @@ public:
     virtual ~PawnPiece() {}
 
     virtual bool CanMovePiece(int curr_x, int curr_y, int dest_x, int dest_y,
-                              ChessPiece *board[8][8], TurnInfo &prev_turn);
+                              ChessPiece *board[8][8],
+                              const MoveHistory &history);
 
 private:
-    bool CheckForEnPassant(TurnInfo prev_turn, int dest_x);
+    bool CheckForEnPassant(const MoveHistory &history, int dest_x,
+                           int dest_y) const;
 };
 
 class KnightPiece : public ChessPiece {
@@ -82,7 +72,8 @@ public:
     virtual ~KnightPiece() {}
 
     virtual bool CanMovePiece(int curr_x, int curr_y, int dest_x, int dest_y,
-                              ChessPiece *board[8][8], TurnInfo &prev_turn);
+                              ChessPiece *board[8][8],
+                              const MoveHistory &history);
 };
 
 class BishopPiece : public ChessPiece {
@@ -91,7 +82,8 @@ public:
     virtual ~BishopPiece() {}
 
     virtual bool CanMovePiece(int curr_x, int curr_y, int dest_x, int dest_y,
-                              ChessPiece *board[8][8], TurnInfo &prev_turn);
+                              ChessPiece *board[8][8],
+                              const MoveHistory &history);
 };
 
 class RookPiece : public ChessPiece {
@@ -100,7 +92,8 @@ public:
     virtual ~RookPiece() {}
 
     virtual bool CanMovePiece(int curr_x, int curr_y, int dest_x, int dest_y,
-                              ChessPiece *board[8][8], TurnInfo &prev_turn);
+                              ChessPiece *board[8][8],
+                              const MoveHistory &history);
 };
 
 class QueenPiece : public ChessPiece {
@@ -109,7 +102,8 @@ public:
     virtual ~QueenPiece() {}
 
     virtual bool CanMovePiece(int curr_x, int curr_y, int dest_x, int dest_y,
-                              ChessPiece *board[8][8], TurnInfo &prev_turn);
+                              ChessPiece *board[8][8],
+                              const MoveHistory &history);
 };
 
 class KingPiece : public ChessPiece {
@@ -118,7 +112,8 @@ public:
     virtual ~KingPiece() {}
 
     virtual bool CanMovePiece(int curr_x, int curr_y, int dest_x, int dest_y,
-                              ChessPiece *board[8][8], TurnInfo &prev_turn);
+                              ChessPiece *board[8][8],
+                              const MoveHistory &history);
 };
 
 #endif
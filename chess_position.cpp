@@ -0,0 +1,999 @@
+#include "chess_position.h"
+#include "chess_board.h"
+
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+
+const char *const ChessPosition::kStartFen =
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+// Ray directions: the first four are rook moves, the last four bishop moves.
+static const int kDirectionX[8] = {1, -1, 0, 0, 1, 1, -1, -1};
+static const int kDirectionY[8] = {0, 0, 1, -1, 1, -1, 1, -1};
+
+static const int kKnightX[8] = {1, 2, 2, 1, -1, -2, -2, -1};
+static const int kKnightY[8] = {-2, -1, 1, 2, 2, 1, -1, -2};
+
+// Target lists are terminated by -1.
+struct AttackTables {
+    int8_t knight[64][9];
+    int8_t king[64][9];
+    int8_t rays[64][8][8];
+    // Which ray of the first square the second is on, -1 if none.
+    int8_t direction[64][64];
+    int    castling_mask[64];
+
+    AttackTables();
+};
+
+AttackTables::AttackTables()
+{
+    memset(direction, -1, sizeof(direction));
+
+    for (int square = 0; square < 64; ++square) {
+        int x = SquareX(square), y = SquareY(square);
+        int knights = 0, kings = 0;
+
+        for (int i = 0; i < 8; ++i) {
+            int kx = x + kKnightX[i], ky = y + kKnightY[i];
+            if (kx >= 0 && kx < 8 && ky >= 0 && ky < 8)
+                knight[square][knights++] = SquareIndex(kx, ky);
+
+            int gx = x + kDirectionX[i], gy = y + kDirectionY[i];
+            if (gx >= 0 && gx < 8 && gy >= 0 && gy < 8)
+                king[square][kings++] = SquareIndex(gx, gy);
+
+            int length = 0;
+            for (int rx = gx, ry = gy; rx >= 0 && rx < 8 && ry >= 0 && ry < 8;
+                 rx += kDirectionX[i], ry += kDirectionY[i]) {
+                direction[square][SquareIndex(rx, ry)] = i;
+                rays[square][i][length++] = SquareIndex(rx, ry);
+            }
+            rays[square][i][length] = -1;
+        }
+        knight[square][knights] = -1;
+        king[square][kings]     = -1;
+
+        castling_mask[square] = 15;
+    }
+
+    castling_mask[SquareIndex(4, 7)] &= ~(ChessPosition::WhiteKingSide |
+                                          ChessPosition::WhiteQueenSide);
+    castling_mask[SquareIndex(7, 7)] &= ~ChessPosition::WhiteKingSide;
+    castling_mask[SquareIndex(0, 7)] &= ~ChessPosition::WhiteQueenSide;
+    castling_mask[SquareIndex(4, 0)] &= ~(ChessPosition::BlackKingSide |
+                                          ChessPosition::BlackQueenSide);
+    castling_mask[SquareIndex(7, 0)] &= ~ChessPosition::BlackKingSide;
+    castling_mask[SquareIndex(0, 0)] &= ~ChessPosition::BlackQueenSide;
+}
+
+static const AttackTables kTables;
+
+struct ZobristKeys {
+    uint64_t pieces[16][64];
+    uint64_t castling[16];
+    uint64_t ep_file[8];
+    uint64_t side;
+
+    ZobristKeys();
+};
+
+ZobristKeys::ZobristKeys()
+{
+    // splitmix64 with a fixed seed, so keys are the same on every run.
+    uint64_t seed = 0x9e3779b97f4a7c15ULL;
+    auto     next = [&seed]() {
+        uint64_t z = (seed += 0x9e3779b97f4a7c15ULL);
+        z          = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z          = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    };
+
+    for (int piece = 0; piece < 16; ++piece)
+        for (int square = 0; square < 64; ++square)
+            pieces[piece][square] = next();
+    for (int rights = 0; rights < 16; ++rights)
+        castling[rights] = next();
+    for (int file = 0; file < 8; ++file)
+        ep_file[file] = next();
+    side = next();
+}
+
+static const ZobristKeys kZobrist;
+
+int CountRepetitions(uint64_t key, const uint64_t *previous, int count,
+                     int halfmove_clock, int limit)
+{
+    int found = 0;
+    int depth = halfmove_clock < count ? halfmove_clock : count;
+
+    for (int back = 2; back <= depth; back += 2) {
+        if (previous[count - back] == key && ++found >= limit)
+            break;
+    }
+    return found;
+}
+
+void AppendSquare(std::string &str, int square)
+{
+    str += static_cast<char>('a' + SquareX(square));
+    str += static_cast<char>('8' - SquareY(square));
+}
+
+std::string ChessMove::ToString() const
+{
+    std::string str;
+    if (IsNull())
+        return "0000";
+
+    AppendSquare(str, GetFrom());
+    AppendSquare(str, GetTo());
+    if (GetPromotion())
+        str += static_cast<char>(
+            tolower(kPieceChars[PieceCodeID(GetPromotion())]));
+    return str;
+}
+
+ChessPosition::ChessPosition()
+{
+    history.reserve(256);
+    SetFromFen(kStartFen);
+}
+
+void ChessPosition::SetNetwork(const NnueNetwork *network)
+{
+    this->network = network;
+    accumulators.clear();
+    if (network) {
+        accumulators.reserve(256);
+        RefreshAccumulator();
+    }
+}
+
+void ChessPosition::RefreshAccumulator()
+{
+    accumulators.resize(1);
+    network->Refresh(*this, TeamID::White, accumulators[0]);
+    network->Refresh(*this, TeamID::Black, accumulators[0]);
+}
+
+// Called by MakeMove once the board is updated. A side whose king moved
+// has every feature change and is rebuilt; the other side only sees the
+// pieces that moved.
+void ChessPosition::UpdateAccumulator(const ChessMove &move)
+{
+    TeamID    team  = OtherTeam(side_to_move);
+    PieceCode piece = move.GetPiece();
+    NnueDelta delta;
+
+    if (PieceCodeID(piece) != ChessPiece::King) {
+        delta.Remove(piece, move.GetFrom());
+        delta.Add(move.GetPromotion() ? move.GetPromotion() : piece,
+                  move.GetTo());
+    }
+    if (move.GetFlag() == ChessMove::EnPassant)
+        delta.Remove(move.GetCaptured(),
+                     move.GetTo() + (team == TeamID::White ? 8 : -8));
+    else if (move.IsCapture())
+        delta.Remove(move.GetCaptured(), move.GetTo());
+    if (move.GetFlag() == ChessMove::Castling) {
+        PieceCode rook      = MakePieceCode(team, ChessPiece::Rook);
+        bool      king_side = move.GetTo() > move.GetFrom();
+        int       y         = SquareY(move.GetFrom());
+        delta.Remove(rook, SquareIndex(king_side ? 7 : 0, y));
+        delta.Add(rook, SquareIndex(king_side ? 5 : 3, y));
+    }
+
+    accumulators.push_back(accumulators.back());
+    NnueAccumulator &accumulator = accumulators.back();
+    for (TeamID perspective : {TeamID::White, TeamID::Black}) {
+        if (perspective == team && PieceCodeID(piece) == ChessPiece::King)
+            network->Refresh(*this, perspective, accumulator);
+        else
+            network->Update(accumulator, perspective,
+                            GetKingSquare(perspective), delta);
+    }
+}
+
+void ChessPosition::Clear()
+{
+    memset(squares, kNoPiece, sizeof(squares));
+    side_to_move         = TeamID::White;
+    king_square[0]       = kNoSquare;
+    king_square[1]       = kNoSquare;
+    fullmove_number      = 1;
+    state.castling       = 0;
+    state.ep_square      = kNoSquare;
+    state.halfmove_clock = 0;
+    key                  = 0;
+    history.clear();
+    keys.clear();
+}
+
+void ChessPosition::ComputeKey()
+{
+    key = 0;
+    for (int square = 0; square < 64; ++square)
+        if (squares[square])
+            key ^= kZobrist.pieces[squares[square]][square];
+
+    key ^= kZobrist.castling[state.castling];
+    if (state.ep_square != kNoSquare)
+        key ^= kZobrist.ep_file[SquareX(state.ep_square)];
+    if (side_to_move == TeamID::Black)
+        key ^= kZobrist.side;
+}
+
+// The en passant square only matters (and only enters the key) when a pawn
+// of the side to move stands ready to take; otherwise positions that differ
+// only in it would never count as repetitions.
+bool ChessPosition::CanCaptureEnPassant(int ep_square) const
+{
+    int       x    = SquareX(ep_square);
+    int       y    = side_to_move == TeamID::White ? 3 : 4;
+    PieceCode pawn = MakePieceCode(side_to_move, ChessPiece::Pawn);
+
+    if (SquareY(ep_square) != (side_to_move == TeamID::White ? 2 : 5))
+        return false;
+    return (x > 0 && squares[SquareIndex(x - 1, y)] == pawn) ||
+           (x < 7 && squares[SquareIndex(x + 1, y)] == pawn);
+}
+
+// Completes SetFromFen and Setup once pieces, side and rights are placed.
+bool ChessPosition::Finish()
+{
+    // Drop rights the piece placement cannot support.
+    const PieceCode white_rook = MakePieceCode(TeamID::White, ChessPiece::Rook);
+    const PieceCode black_rook = MakePieceCode(TeamID::Black, ChessPiece::Rook);
+    if (king_square[0] != SquareIndex(4, 7))
+        state.castling &= ~(WhiteKingSide | WhiteQueenSide);
+    if (king_square[1] != SquareIndex(4, 0))
+        state.castling &= ~(BlackKingSide | BlackQueenSide);
+    if (squares[SquareIndex(7, 7)] != white_rook)
+        state.castling &= ~WhiteKingSide;
+    if (squares[SquareIndex(0, 7)] != white_rook)
+        state.castling &= ~WhiteQueenSide;
+    if (squares[SquareIndex(7, 0)] != black_rook)
+        state.castling &= ~BlackKingSide;
+    if (squares[SquareIndex(0, 0)] != black_rook)
+        state.castling &= ~BlackQueenSide;
+
+    if (state.ep_square != kNoSquare && !CanCaptureEnPassant(state.ep_square))
+        state.ep_square = kNoSquare;
+
+    ComputeKey();
+    if (network)
+        RefreshAccumulator();
+
+    // The side not to move must not be in check.
+    return IsLastMoveLegal();
+}
+
+bool ChessPosition::Setup(const PieceCode board[64], TeamID side,
+                          int castling, int ep_square, int halfmove_clock)
+{
+    int kings[2] = {0, 0};
+
+    Clear();
+    for (int square = 0; square < 64; ++square) {
+        PieceCode piece = board[square];
+        squares[square] = piece;
+        if (piece && PieceCodeID(piece) == ChessPiece::King) {
+            king_square[static_cast<int>(PieceCodeTeam(piece))] = square;
+            ++kings[static_cast<int>(PieceCodeTeam(piece))];
+        }
+    }
+    if (kings[0] != 1 || kings[1] != 1)
+        return false;
+
+    side_to_move         = side;
+    state.castling       = castling & 15;
+    state.ep_square      = ep_square;
+    state.halfmove_clock = halfmove_clock;
+    return Finish();
+}
+
+bool ChessPosition::HasNonPawnMaterial(TeamID team) const
+{
+    for (int square = 0; square < 64; ++square) {
+        PieceCode piece = squares[square];
+        if (piece && PieceCodeTeam(piece) == team &&
+            PieceCodeID(piece) != ChessPiece::Pawn &&
+            PieceCodeID(piece) != ChessPiece::King)
+            return true;
+    }
+    return false;
+}
+
+bool ChessPosition::HasInsufficientMaterial() const
+{
+    int knights = 0, bishops = 0, bishop_colors = 0;
+
+    for (int square = 0; square < 64; ++square) {
+        PieceCode piece = squares[square];
+        if (!piece)
+            continue;
+
+        switch (PieceCodeID(piece)) {
+        case ChessPiece::Pawn:
+        case ChessPiece::Rook:
+        case ChessPiece::Queen:
+            return false;
+        case ChessPiece::Knight:
+            ++knights;
+            break;
+        case ChessPiece::Bishop:
+            ++bishops;
+            bishop_colors |= 1 << ((SquareX(square) + SquareY(square)) & 1);
+            break;
+        default:
+            break;
+        }
+    }
+
+    // Bare kings or a single minor piece; otherwise only bishops that all
+    // stand on squares of one colour.
+    if (knights + bishops <= 1)
+        return true;
+    return knights == 0 && bishop_colors != 3;
+}
+
+bool ChessPosition::SetFromFen(const char *fen)
+{
+    static const char kFenPieces[] = "PNBRQK";
+
+    Clear();
+
+    const char *p = fen;
+    int         x = 0, y = 0;
+    int         kings[2] = {0, 0};
+
+    for (; *p && *p != ' '; ++p) {
+        if (*p == '/') {
+            if (x != 8 || ++y > 7)
+                return false;
+            x = 0;
+        } else if (*p >= '1' && *p <= '8') {
+            x += *p - '0';
+            if (x > 8)
+                return false;
+        } else {
+            const char *id = strchr(kFenPieces, toupper(*p));
+            if (!id || x > 7)
+                return false;
+
+            TeamID team = isupper(*p) ? TeamID::White : TeamID::Black;
+            auto   pid  = static_cast<ChessPiece::PieceID>(id - kFenPieces);
+            if (pid == ChessPiece::Pawn && (y == 0 || y == 7))
+                return false;
+
+            squares[SquareIndex(x, y)] = MakePieceCode(team, pid);
+            if (pid == ChessPiece::King) {
+                king_square[static_cast<int>(team)] = SquareIndex(x, y);
+                ++kings[static_cast<int>(team)];
+            }
+            ++x;
+        }
+    }
+    if (x != 8 || y != 7 || kings[0] != 1 || kings[1] != 1)
+        return false;
+
+    while (*p == ' ')
+        ++p;
+    if (*p == 'w')
+        side_to_move = TeamID::White;
+    else if (*p == 'b')
+        side_to_move = TeamID::Black;
+    else
+        return false;
+    ++p;
+
+    while (*p == ' ')
+        ++p;
+    for (; *p && *p != ' '; ++p) {
+        switch (*p) {
+        case 'K': state.castling |= WhiteKingSide; break;
+        case 'Q': state.castling |= WhiteQueenSide; break;
+        case 'k': state.castling |= BlackKingSide; break;
+        case 'q': state.castling |= BlackQueenSide; break;
+        case '-': break;
+        default: return false;
+        }
+    }
+
+    while (*p == ' ')
+        ++p;
+    if (*p && *p != '-') {
+        int ep_x, ep_y;
+        if (!ParseSquare(p, ep_x, ep_y))
+            return false;
+        state.ep_square = SquareIndex(ep_x, ep_y);
+        p += 2;
+    } else if (*p) {
+        ++p;
+    }
+
+    // Clocks are optional so EPD records can be parsed as well.
+    char *end;
+    state.halfmove_clock = strtol(p, &end, 10);
+    if (end != p) {
+        p               = end;
+        fullmove_number = strtol(p, &end, 10);
+        if (end == p || fullmove_number < 1)
+            fullmove_number = 1;
+    }
+
+    return Finish();
+}
+
+std::string ChessPosition::GetFen() const
+{
+    std::string fen;
+
+    for (int y = 0; y < 8; ++y) {
+        int empty = 0;
+        for (int x = 0; x < 8; ++x) {
+            PieceCode piece = squares[SquareIndex(x, y)];
+            if (!piece) {
+                ++empty;
+                continue;
+            }
+            if (empty)
+                fen += static_cast<char>('0' + empty);
+            empty   = 0;
+            char ch = "PNBRQK"[PieceCodeID(piece)];
+            fen += PieceCodeTeam(piece) == TeamID::White ? ch : tolower(ch);
+        }
+        if (empty)
+            fen += static_cast<char>('0' + empty);
+        if (y < 7)
+            fen += '/';
+    }
+
+    fen += side_to_move == TeamID::White ? " w " : " b ";
+    if (state.castling & WhiteKingSide)
+        fen += 'K';
+    if (state.castling & WhiteQueenSide)
+        fen += 'Q';
+    if (state.castling & BlackKingSide)
+        fen += 'k';
+    if (state.castling & BlackQueenSide)
+        fen += 'q';
+    if (!state.castling)
+        fen += '-';
+
+    fen += ' ';
+    if (state.ep_square != kNoSquare)
+        AppendSquare(fen, state.ep_square);
+    else
+        fen += '-';
+
+    fen += ' ' + std::to_string(state.halfmove_clock) + ' ' +
+           std::to_string(fullmove_number);
+    return fen;
+}
+
+// Works on a bare board so legality checks can ask about a board the move
+// has been tried on.
+static bool IsAttacked(const PieceCode squares[64], int square,
+                       TeamID by_team)
+{
+    const PieceCode pawn   = MakePieceCode(by_team, ChessPiece::Pawn);
+    const PieceCode knight = MakePieceCode(by_team, ChessPiece::Knight);
+    const PieceCode bishop = MakePieceCode(by_team, ChessPiece::Bishop);
+    const PieceCode rook   = MakePieceCode(by_team, ChessPiece::Rook);
+    const PieceCode queen  = MakePieceCode(by_team, ChessPiece::Queen);
+    const PieceCode king   = MakePieceCode(by_team, ChessPiece::King);
+
+    int x = SquareX(square), y = SquareY(square);
+
+    // White pawns attack towards rank 8, so they sit one row below.
+    int pawn_y = by_team == TeamID::White ? y + 1 : y - 1;
+    if (pawn_y >= 0 && pawn_y < 8) {
+        if (x > 0 && squares[SquareIndex(x - 1, pawn_y)] == pawn)
+            return true;
+        if (x < 7 && squares[SquareIndex(x + 1, pawn_y)] == pawn)
+            return true;
+    }
+
+    for (const int8_t *t = kTables.knight[square]; *t >= 0; ++t)
+        if (squares[*t] == knight)
+            return true;
+
+    for (const int8_t *t = kTables.king[square]; *t >= 0; ++t)
+        if (squares[*t] == king)
+            return true;
+
+    for (int dir = 0; dir < 8; ++dir) {
+        PieceCode slider = dir < 4 ? rook : bishop;
+        for (const int8_t *t = kTables.rays[square][dir]; *t >= 0; ++t) {
+            PieceCode piece = squares[*t];
+            if (piece) {
+                if (piece == slider || piece == queen)
+                    return true;
+                break;
+            }
+        }
+    }
+
+    return false;
+}
+
+bool ChessPosition::IsSquareAttacked(int square, TeamID by_team) const
+{
+    return IsAttacked(squares, square, by_team);
+}
+
+void ChessPosition::AddPawnMoves(ChessMoveList &moves, int from,
+                                 int kinds) const
+{
+    PieceCode piece  = squares[from];
+    TeamID    team   = side_to_move;
+    int       x      = SquareX(from), y = SquareY(from);
+    int       dir    = team == TeamID::White ? -1 : 1;
+    int       start  = team == TeamID::White ? 6 : 1;
+    int       last   = team == TeamID::White ? 0 : 7;
+    int       next_y = y + dir;
+
+    static const ChessPiece::PieceID kPromotions[] = {
+        ChessPiece::Queen, ChessPiece::Rook, ChessPiece::Bishop,
+        ChessPiece::Knight};
+
+    auto add = [&](int to, PieceCode captured) {
+        if (SquareY(to) == last) {
+            for (ChessPiece::PieceID promotion : kPromotions)
+                moves.Add(ChessMove(from, to, piece, captured,
+                                    MakePieceCode(team, promotion)));
+        } else {
+            moves.Add(ChessMove(from, to, piece, captured));
+        }
+    };
+
+    // Pushes to the last rank promote, which makes them noisy.
+    int to = SquareIndex(x, next_y);
+    if (!squares[to]) {
+        if (kinds & (next_y == last ? NoisyMoves : QuietMoves))
+            add(to, kNoPiece);
+        int two = SquareIndex(x, next_y + dir);
+        if ((kinds & QuietMoves) && y == start && !squares[two])
+            moves.Add(ChessMove(from, two, piece, kNoPiece, kNoPiece,
+                                ChessMove::DoublePush));
+    }
+
+    if (!(kinds & NoisyMoves))
+        return;
+    for (int dx = -1; dx <= 1; dx += 2) {
+        if (x + dx < 0 || x + dx > 7)
+            continue;
+        to                 = SquareIndex(x + dx, next_y);
+        PieceCode captured = squares[to];
+        if (captured && PieceCodeTeam(captured) != team) {
+            add(to, captured);
+        } else if (to == state.ep_square) {
+            moves.Add(ChessMove(from, to, piece,
+                                MakePieceCode(OtherTeam(team),
+                                              ChessPiece::Pawn),
+                                kNoPiece, ChessMove::EnPassant));
+        }
+    }
+}
+
+void ChessPosition::AddPieceMoves(ChessMoveList &moves, int from,
+                                  int kinds) const
+{
+    PieceCode           piece = squares[from];
+    ChessPiece::PieceID id    = PieceCodeID(piece);
+
+    auto try_add = [&](int to) {
+        PieceCode target = squares[to];
+        if (!target) {
+            if (kinds & QuietMoves)
+                moves.Add(ChessMove(from, to, piece));
+        } else if ((kinds & NoisyMoves) &&
+                   PieceCodeTeam(target) != side_to_move) {
+            moves.Add(ChessMove(from, to, piece, target));
+        }
+        return !target;
+    };
+
+    if (id == ChessPiece::Knight || id == ChessPiece::King) {
+        const int8_t *targets = id == ChessPiece::Knight
+                                    ? kTables.knight[from]
+                                    : kTables.king[from];
+        for (const int8_t *t = targets; *t >= 0; ++t)
+            try_add(*t);
+        return;
+    }
+
+    int first = id == ChessPiece::Bishop ? 4 : 0;
+    int end   = id == ChessPiece::Rook ? 4 : 8;
+    for (int dir = first; dir < end; ++dir)
+        for (const int8_t *t = kTables.rays[from][dir]; *t >= 0; ++t)
+            if (!try_add(*t))
+                break;
+}
+
+void ChessPosition::AddCastlingMoves(ChessMoveList &moves) const
+{
+    TeamID    team   = side_to_move;
+    TeamID    enemy  = OtherTeam(team);
+    int       y      = team == TeamID::White ? 7 : 0;
+    int       king   = SquareIndex(4, y);
+    int       rights = state.castling;
+    PieceCode piece  = squares[king];
+
+    int king_side  = team == TeamID::White ? WhiteKingSide : BlackKingSide;
+    int queen_side = team == TeamID::White ? WhiteQueenSide : BlackQueenSide;
+
+    if (!(rights & (king_side | queen_side)) ||
+        IsSquareAttacked(king, enemy))
+        return;
+
+    if ((rights & king_side) && !squares[SquareIndex(5, y)] &&
+        !squares[SquareIndex(6, y)] &&
+        !IsSquareAttacked(SquareIndex(5, y), enemy) &&
+        !IsSquareAttacked(SquareIndex(6, y), enemy))
+        moves.Add(ChessMove(king, SquareIndex(6, y), piece, kNoPiece,
+                            kNoPiece, ChessMove::Castling));
+
+    if ((rights & queen_side) && !squares[SquareIndex(3, y)] &&
+        !squares[SquareIndex(2, y)] && !squares[SquareIndex(1, y)] &&
+        !IsSquareAttacked(SquareIndex(3, y), enemy) &&
+        !IsSquareAttacked(SquareIndex(2, y), enemy))
+        moves.Add(ChessMove(king, SquareIndex(2, y), piece, kNoPiece,
+                            kNoPiece, ChessMove::Castling));
+}
+
+void ChessPosition::GenerateMoves(ChessMoveList &moves, int kinds) const
+{
+    moves.Clear();
+
+    for (int from = 0; from < 64; ++from) {
+        PieceCode piece = squares[from];
+        if (!piece || PieceCodeTeam(piece) != side_to_move)
+            continue;
+
+        if (PieceCodeID(piece) == ChessPiece::Pawn)
+            AddPawnMoves(moves, from, kinds);
+        else
+            AddPieceMoves(moves, from, kinds);
+    }
+
+    if (kinds & QuietMoves)
+        AddCastlingMoves(moves);
+}
+
+void ChessPosition::GeneratePseudoLegalMoves(ChessMoveList &moves) const
+{
+    GenerateMoves(moves, AllMoves);
+}
+
+void ChessPosition::GenerateCaptures(ChessMoveList &moves) const
+{
+    GenerateMoves(moves, NoisyMoves);
+}
+
+void ChessPosition::GenerateQuiets(ChessMoveList &moves) const
+{
+    GenerateMoves(moves, QuietMoves);
+}
+
+void ChessPosition::GenerateLegalMoves(ChessMoveList &moves) const
+{
+    ChessMoveList pseudo;
+    CheckInfo     info;
+    GeneratePseudoLegalMoves(pseudo);
+    ComputeCheckInfo(info);
+
+    moves.Clear();
+    for (int i = 0; i < pseudo.Size(); ++i)
+        if (IsLegal(pseudo[i], info))
+            moves.Add(pseudo[i]);
+}
+
+void ChessPosition::ComputeCheckInfo(CheckInfo &info) const
+{
+    TeamID    team   = side_to_move;
+    TeamID    enemy  = OtherTeam(team);
+    int       king   = GetKingSquare(team);
+    int       x      = SquareX(king), y = SquareY(king);
+    PieceCode pawn   = MakePieceCode(enemy, ChessPiece::Pawn);
+    PieceCode knight = MakePieceCode(enemy, ChessPiece::Knight);
+    PieceCode bishop = MakePieceCode(enemy, ChessPiece::Bishop);
+    PieceCode rook   = MakePieceCode(enemy, ChessPiece::Rook);
+    PieceCode queen  = MakePieceCode(enemy, ChessPiece::Queen);
+    uint64_t  mask   = 0;
+
+    info = CheckInfo();
+
+    int pawn_y = enemy == TeamID::White ? y + 1 : y - 1;
+    if (pawn_y >= 0 && pawn_y < 8) {
+        for (int dx = -1; dx <= 1; dx += 2) {
+            int square = SquareIndex(x + dx, pawn_y);
+            if (x + dx >= 0 && x + dx < 8 && squares[square] == pawn) {
+                mask |= 1ull << square;
+                ++info.checkers;
+            }
+        }
+    }
+
+    for (const int8_t *t = kTables.knight[king]; *t >= 0; ++t) {
+        if (squares[*t] == knight) {
+            mask |= 1ull << *t;
+            ++info.checkers;
+        }
+    }
+
+    // Walking out from the king, an enemy slider right behind one of our
+    // own pieces pins it; with nothing in between it gives check.
+    for (int dir = 0; dir < 8; ++dir) {
+        PieceCode slider  = dir < 4 ? rook : bishop;
+        int       shield  = kNoSquare;
+        uint64_t  between = 0;
+
+        for (const int8_t *t = kTables.rays[king][dir]; *t >= 0; ++t) {
+            PieceCode piece = squares[*t];
+            between |= 1ull << *t;
+            if (!piece)
+                continue;
+
+            if (PieceCodeTeam(piece) == team) {
+                if (shield != kNoSquare)
+                    break;
+                shield = *t;
+                continue;
+            }
+            if (piece == slider || piece == queen) {
+                if (shield == kNoSquare) {
+                    mask |= between;
+                    ++info.checkers;
+                } else {
+                    info.pinned |= 1ull << shield;
+                }
+            }
+            break;
+        }
+    }
+
+    if (info.checkers)
+        info.check_mask = mask;
+}
+
+bool ChessPosition::IsKingSafeAfter(const ChessMove &move) const
+{
+    PieceCode board[64];
+    int       from = move.GetFrom(), to = move.GetTo();
+    TeamID    team = side_to_move;
+    int       king = GetKingSquare(team);
+
+    memcpy(board, squares, sizeof(board));
+    if (move.GetFlag() == ChessMove::EnPassant)
+        board[to + (team == TeamID::White ? 8 : -8)] = kNoPiece;
+    board[to]   = board[from];
+    board[from] = kNoPiece;
+
+    return !IsAttacked(board, from == king ? to : king, OtherTeam(team));
+}
+
+bool ChessPosition::IsLegal(const ChessMove &move,
+                            const CheckInfo &info) const
+{
+    int from = move.GetFrom(), to = move.GetTo();
+    int king = GetKingSquare(side_to_move);
+
+    // Castling only gets generated when the squares it crosses are safe.
+    if (move.GetFlag() == ChessMove::Castling)
+        return true;
+    if (from == king || move.GetFlag() == ChessMove::EnPassant)
+        return IsKingSafeAfter(move);
+
+    if (info.checkers > 1 || !(info.check_mask >> to & 1))
+        return false;
+    return !(info.pinned >> from & 1) ||
+           kTables.direction[king][from] == kTables.direction[king][to];
+}
+
+bool ChessPosition::IsPseudoLegal(const ChessMove &move) const
+{
+    int from = move.GetFrom();
+    if (move.IsNull() || squares[from] != move.GetPiece() ||
+        PieceCodeTeam(squares[from]) != side_to_move)
+        return false;
+
+    // Generating the moves of one piece is cheap and cannot disagree with
+    // the generator about what is pseudo-legal.
+    ChessMoveList moves;
+    if (move.GetFlag() == ChessMove::Castling)
+        AddCastlingMoves(moves);
+    else if (PieceCodeID(squares[from]) == ChessPiece::Pawn)
+        AddPawnMoves(moves, from, AllMoves);
+    else
+        AddPieceMoves(moves, from, AllMoves);
+
+    for (int i = 0; i < moves.Size(); ++i)
+        if (moves[i] == move)
+            return true;
+    return false;
+}
+
+void ChessPosition::MakeMove(const ChessMove &move)
+{
+    int       from     = move.GetFrom();
+    int       to       = move.GetTo();
+    PieceCode piece    = move.GetPiece();
+    PieceCode captured = move.GetCaptured();
+    PieceCode placed   = move.GetPromotion() ? move.GetPromotion() : piece;
+    TeamID    team     = side_to_move;
+
+    history.push_back(state);
+    keys.push_back(key);
+
+    if (state.ep_square != kNoSquare)
+        key ^= kZobrist.ep_file[SquareX(state.ep_square)];
+    state.ep_square = kNoSquare;
+
+    ++state.halfmove_clock;
+    if (captured || PieceCodeID(piece) == ChessPiece::Pawn)
+        state.halfmove_clock = 0;
+
+    switch (move.GetFlag()) {
+    case ChessMove::EnPassant: {
+        int victim = to + (team == TeamID::White ? 8 : -8);
+        key ^= kZobrist.pieces[captured][victim];
+        squares[victim] = kNoPiece;
+        break;
+    }
+    case ChessMove::Castling: {
+        int       y         = SquareY(from);
+        int       rook_from = SquareIndex(to > from ? 7 : 0, y);
+        int       rook_to   = SquareIndex(to > from ? 5 : 3, y);
+        PieceCode rook      = squares[rook_from];
+        key ^= kZobrist.pieces[rook][rook_from] ^ kZobrist.pieces[rook][rook_to];
+        squares[rook_to]   = rook;
+        squares[rook_from] = kNoPiece;
+        break;
+    }
+    default:
+        if (captured)
+            key ^= kZobrist.pieces[captured][to];
+        break;
+    }
+
+    key ^= kZobrist.pieces[piece][from] ^ kZobrist.pieces[placed][to];
+    squares[to]   = placed;
+    squares[from] = kNoPiece;
+
+    if (PieceCodeID(piece) == ChessPiece::King)
+        king_square[static_cast<int>(team)] = to;
+
+    int castling = state.castling & kTables.castling_mask[from] &
+                   kTables.castling_mask[to];
+    if (castling != state.castling) {
+        key ^= kZobrist.castling[state.castling] ^ kZobrist.castling[castling];
+        state.castling = castling;
+    }
+
+    if (team == TeamID::Black)
+        ++fullmove_number;
+    side_to_move = OtherTeam(team);
+    key ^= kZobrist.side;
+
+    if (move.GetFlag() == ChessMove::DoublePush &&
+        CanCaptureEnPassant((from + to) / 2)) {
+        state.ep_square = (from + to) / 2;
+        key ^= kZobrist.ep_file[SquareX(state.ep_square)];
+    }
+
+    if (network)
+        UpdateAccumulator(move);
+}
+
+uint64_t ChessPosition::KeyAfter(const ChessMove &move) const
+{
+    PieceCode piece  = move.GetPiece();
+    PieceCode placed = move.GetPromotion() ? move.GetPromotion() : piece;
+    uint64_t  after  = key ^ kZobrist.side ^
+                      kZobrist.pieces[piece][move.GetFrom()] ^
+                      kZobrist.pieces[placed][move.GetTo()];
+
+    if (move.IsCapture() && move.GetFlag() != ChessMove::EnPassant)
+        after ^= kZobrist.pieces[move.GetCaptured()][move.GetTo()];
+    if (state.ep_square != kNoSquare)
+        after ^= kZobrist.ep_file[SquareX(state.ep_square)];
+    return after;
+}
+
+void ChessPosition::UnmakeMove(const ChessMove &move)
+{
+    int       from     = move.GetFrom();
+    int       to       = move.GetTo();
+    PieceCode piece    = move.GetPiece();
+    TeamID    team     = OtherTeam(side_to_move);
+
+    side_to_move = team;
+    if (team == TeamID::Black)
+        --fullmove_number;
+
+    squares[from] = piece;
+    squares[to]   = move.GetCaptured();
+
+    switch (move.GetFlag()) {
+    case ChessMove::EnPassant:
+        squares[to] = kNoPiece;
+        squares[to + (team == TeamID::White ? 8 : -8)] = move.GetCaptured();
+        break;
+    case ChessMove::Castling: {
+        int y         = SquareY(from);
+        int rook_from = SquareIndex(to > from ? 7 : 0, y);
+        int rook_to   = SquareIndex(to > from ? 5 : 3, y);
+        squares[rook_from] = squares[rook_to];
+        squares[rook_to]   = kNoPiece;
+        break;
+    }
+    default:
+        break;
+    }
+
+    if (PieceCodeID(piece) == ChessPiece::King)
+        king_square[static_cast<int>(team)] = from;
+
+    state = history.back();
+    key   = keys.back();
+    history.pop_back();
+    keys.pop_back();
+    if (network)
+        accumulators.pop_back();
+}
+
+void ChessPosition::MakeNullMove()
+{
+    history.push_back(state);
+    keys.push_back(key);
+
+    if (state.ep_square != kNoSquare)
+        key ^= kZobrist.ep_file[SquareX(state.ep_square)];
+    state.ep_square      = kNoSquare;
+    state.halfmove_clock = 0;
+
+    side_to_move = OtherTeam(side_to_move);
+    key ^= kZobrist.side;
+}
+
+void ChessPosition::UnmakeNullMove()
+{
+    side_to_move = OtherTeam(side_to_move);
+
+    state = history.back();
+    key   = keys.back();
+    history.pop_back();
+    keys.pop_back();
+}
+
+ChessMove ChessPosition::ParseMove(const char *str)
+{
+    ChessMoveList moves;
+    GenerateLegalMoves(moves);
+
+    for (int i = 0; i < moves.Size(); ++i)
+        if (moves[i].ToString() == str)
+            return moves[i];
+    return ChessMove();
+}
+
+uint64_t ChessPosition::Perft(int depth)
+{
+    ChessMoveList moves;
+    GenerateLegalMoves(moves);
+
+    if (depth <= 1)
+        return depth == 1 ? moves.Size() : 1;
+
+    uint64_t nodes = 0;
+    for (int i = 0; i < moves.Size(); ++i) {
+        MakeMove(moves[i]);
+        nodes += Perft(depth - 1);
+        UnmakeMove(moves[i]);
+    }
+    return nodes;
+}
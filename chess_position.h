@@ -0,0 +1,252 @@
+#ifndef CHESS_POSITION_H
+#define CHESS_POSITION_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "chess_nnue.h"
+#include "chess_pieces.h"
+
+// Squares are numbered like ChessBoard cells: index = y * 8 + x with y = 0
+// being rank 8, so a8 = 0 and h1 = 63.
+const int kNoSquare = -1;
+
+inline int SquareIndex(int x, int y) { return y * 8 + x; }
+inline int SquareX(int square) { return square & 7; }
+inline int SquareY(int square) { return square >> 3; }
+
+// Appends the square's name, e.g. "e4".
+void AppendSquare(std::string &str, int square);
+
+// Piece codes: 0 is empty, otherwise (team << 3) | (PieceID + 1).
+typedef int8_t PieceCode;
+const PieceCode kNoPiece = 0;
+
+inline PieceCode MakePieceCode(TeamID team, ChessPiece::PieceID id)
+{
+    return static_cast<PieceCode>((static_cast<int>(team) << 3) | (id + 1));
+}
+inline ChessPiece::PieceID PieceCodeID(PieceCode code)
+{
+    return static_cast<ChessPiece::PieceID>((code & 7) - 1);
+}
+inline TeamID PieceCodeTeam(PieceCode code)
+{
+    return static_cast<TeamID>(code >> 3);
+}
+inline TeamID OtherTeam(TeamID team)
+{
+    return team == TeamID::White ? TeamID::Black : TeamID::White;
+}
+
+// Packed into 32 bits: from, to, moving piece, captured piece, promotion
+// piece and a flag, so a move can be undone without looking at the board.
+class ChessMove {
+    uint32_t data;
+
+public:
+    enum Flag { Normal, DoublePush, EnPassant, Castling };
+
+    ChessMove() : data(0) {}
+    ChessMove(int from, int to, PieceCode piece, PieceCode captured = kNoPiece,
+              PieceCode promotion = kNoPiece, Flag flag = Normal)
+        : data(from | to << 6 | (piece & 15) << 12 | (captured & 15) << 16 |
+               (promotion & 15) << 20 | flag << 24)
+    {
+    }
+
+    int       GetFrom() const { return data & 63; }
+    int       GetTo() const { return (data >> 6) & 63; }
+    PieceCode GetPiece() const { return (data >> 12) & 15; }
+    PieceCode GetCaptured() const { return (data >> 16) & 15; }
+    PieceCode GetPromotion() const { return (data >> 20) & 15; }
+    Flag      GetFlag() const { return static_cast<Flag>((data >> 24) & 15); }
+
+    bool IsNull() const { return data == 0; }
+    bool IsCapture() const { return GetCaptured() != kNoPiece; }
+    bool IsQuiet() const { return !IsCapture() && !GetPromotion(); }
+
+    // The packed form, for storing moves compactly.
+    uint32_t         ToRaw() const { return data; }
+    static ChessMove FromRaw(uint32_t raw)
+    {
+        ChessMove move;
+        move.data = raw;
+        return move;
+    }
+
+    bool operator==(const ChessMove &other) const { return data == other.data; }
+    bool operator!=(const ChessMove &other) const { return data != other.data; }
+
+    // Long algebraic notation as used by UCI, e.g. "e2e4" or "e7e8q".
+    std::string ToString() const;
+};
+
+// Home square of the rook that a castling move takes along.
+inline int CastlingRookSquare(const ChessMove &move)
+{
+    return move.GetTo() > move.GetFrom() ? move.GetFrom() + 3
+                                         : move.GetFrom() - 4;
+}
+
+const int kMaxMoves = 256;
+
+class ChessMoveList {
+    ChessMove moves[kMaxMoves];
+    int       count = 0;
+
+public:
+    void Add(const ChessMove &move) { moves[count++] = move; }
+    void Clear() { count = 0; }
+    int  Size() const { return count; }
+
+    ChessMove       &operator[](int i) { return moves[i]; }
+    const ChessMove &operator[](int i) const { return moves[i]; }
+};
+
+// Counts how often `key` occurs among `previous` (oldest first, last entry
+// one ply ago) since the last irreversible move. Only every second entry
+// can match since the side to move must be the same. Stops at `limit`.
+int CountRepetitions(uint64_t key, const uint64_t *previous, int count,
+                     int halfmove_clock, int limit);
+
+// What legality checks need to know about the king of the side to move.
+// Bit n of a mask stands for square n.
+struct CheckInfo {
+    uint64_t pinned     = 0;    // own pieces that shield the king
+    uint64_t check_mask = ~0ull; // where a non-king move must go to count
+    int      checkers   = 0;
+};
+
+class ChessPosition {
+public:
+    enum CastlingRight {
+        WhiteKingSide  = 1,
+        WhiteQueenSide = 2,
+        BlackKingSide  = 4,
+        BlackQueenSide = 8
+    };
+
+    static const char *const kStartFen;
+
+    ChessPosition();
+
+    // With a network, make/unmake keep its accumulator up to date so
+    // Evaluate can use it. The network must outlive the position.
+    void SetNetwork(const NnueNetwork *network);
+    const NnueNetwork *GetNetwork() const { return network; }
+    const NnueAccumulator &GetAccumulator() const
+    {
+        return accumulators.back();
+    }
+
+    bool        SetFromFen(const char *fen);
+    std::string GetFen() const;
+    // Sets up an arbitrary placement; squares use the board layout above.
+    bool Setup(const PieceCode board[64], TeamID side, int castling,
+               int ep_square, int halfmove_clock);
+
+    PieceCode GetPiece(int square) const { return squares[square]; }
+    TeamID    GetSideToMove() const { return side_to_move; }
+    int       GetCastlingRights() const { return state.castling; }
+    int       GetEnPassantSquare() const { return state.ep_square; }
+    int       GetHalfmoveClock() const { return state.halfmove_clock; }
+    uint64_t  GetKey() const { return key; }
+    // The key after `move`, except for castling rights, en passant and the
+    // castling rook: cheap, and right often enough to prefetch with.
+    uint64_t KeyAfter(const ChessMove &move) const;
+    int       GetKingSquare(TeamID team) const
+    {
+        return king_square[static_cast<int>(team)];
+    }
+
+    void GeneratePseudoLegalMoves(ChessMoveList &moves) const;
+    // The two halves of the above: captures and promotions, then the rest.
+    void GenerateCaptures(ChessMoveList &moves) const;
+    void GenerateQuiets(ChessMoveList &moves) const;
+    void GenerateLegalMoves(ChessMoveList &moves) const;
+
+    // Legality of pseudo-legal moves without making them: pinned pieces
+    // stay on the line to their king, in check only moves that take or
+    // block the checker count, and king moves and en passant are tried on
+    // a copy of the board.
+    void ComputeCheckInfo(CheckInfo &info) const;
+    bool IsLegal(const ChessMove &move, const CheckInfo &info) const;
+    // Whether a move remembered from elsewhere, such as a table entry or a
+    // killer slot, is a pseudo-legal move of this position.
+    bool IsPseudoLegal(const ChessMove &move) const;
+
+    void MakeMove(const ChessMove &move);
+    void UnmakeMove(const ChessMove &move);
+    // Passes the turn. Repetitions are not looked for across a null move.
+    void MakeNullMove();
+    void UnmakeNullMove();
+
+    bool IsSquareAttacked(int square, TeamID by_team) const;
+    bool IsInCheck() const
+    {
+        return IsSquareAttacked(GetKingSquare(side_to_move),
+                                OtherTeam(side_to_move));
+    }
+    // True when the side that just moved did not leave its king attacked.
+    bool IsLastMoveLegal() const
+    {
+        return !IsSquareAttacked(GetKingSquare(OtherTeam(side_to_move)),
+                                 side_to_move);
+    }
+
+    // Draw rules. A single earlier occurrence counts as a repetition, which
+    // is what search wants; the game asks for two.
+    bool IsRepetition(int times = 1) const
+    {
+        return CountRepetitions(key, keys.data(), keys.size(),
+                                state.halfmove_clock, times) >= times;
+    }
+    bool IsFiftyMoveDraw() const { return state.halfmove_clock >= 100; }
+    bool HasInsufficientMaterial() const;
+    // Anything besides king and pawns; without it passing is often the best
+    // move (zugzwang) and null-move pruning becomes unsound.
+    bool HasNonPawnMaterial(TeamID team) const;
+
+    // Finds the legal move matching UCI notation; a null move if none does.
+    ChessMove ParseMove(const char *str);
+
+    uint64_t Perft(int depth);
+
+private:
+    struct State {
+        int castling;
+        int ep_square;
+        int halfmove_clock;
+    };
+
+    PieceCode          squares[64];
+    TeamID             side_to_move;
+    int                king_square[2];
+    int                fullmove_number;
+    State              state;
+    uint64_t           key;
+    std::vector<State> history;
+    // Keys of the positions before the current one, oldest first.
+    std::vector<uint64_t> keys;
+
+    const NnueNetwork           *network = nullptr;
+    std::vector<NnueAccumulator> accumulators;
+
+    void Clear();
+    bool Finish();
+    bool CanCaptureEnPassant(int ep_square) const;
+    void ComputeKey();
+    void RefreshAccumulator();
+    void UpdateAccumulator(const ChessMove &move);
+    enum MoveKinds { NoisyMoves = 1, QuietMoves = 2, AllMoves = 3 };
+
+    void GenerateMoves(ChessMoveList &moves, int kinds) const;
+    void AddPawnMoves(ChessMoveList &moves, int from, int kinds) const;
+    void AddPieceMoves(ChessMoveList &moves, int from, int kinds) const;
+    void AddCastlingMoves(ChessMoveList &moves) const;
+    bool IsKingSafeAfter(const ChessMove &move) const;
+};
+
+#endif
@@ -0,0 +1,61 @@
+#include "chess_san.h"
+
+std::string MoveToSan(const ChessPosition &position, const ChessMove &move,
+                      bool mark_checks)
+{
+    ChessPiece::PieceID id   = PieceCodeID(move.GetPiece());
+    int                 from = move.GetFrom(), to = move.GetTo();
+    std::string         san;
+
+    if (move.GetFlag() == ChessMove::Castling) {
+        san = to > from ? "O-O" : "O-O-O";
+    } else if (id == ChessPiece::Pawn) {
+        if (move.IsCapture()) {
+            san += static_cast<char>('a' + SquareX(from));
+            san += 'x';
+        }
+        AppendSquare(san, to);
+        if (move.GetPromotion()) {
+            san += '=';
+            san += kPieceChars[PieceCodeID(move.GetPromotion())];
+        }
+    } else {
+        san += kPieceChars[id];
+
+        // Name the file if that tells the pieces apart, else the rank,
+        // else both.
+        ChessMoveList legal;
+        bool          ambiguous = false, same_file = false, same_rank = false;
+        position.GenerateLegalMoves(legal);
+        for (int i = 0; i < legal.Size(); ++i) {
+            const ChessMove &other = legal[i];
+            if (other.GetTo() != to || other.GetFrom() == from ||
+                other.GetPiece() != move.GetPiece())
+                continue;
+            ambiguous = true;
+            same_file |= SquareX(other.GetFrom()) == SquareX(from);
+            same_rank |= SquareY(other.GetFrom()) == SquareY(from);
+        }
+        if (ambiguous && (!same_file || same_rank))
+            san += static_cast<char>('a' + SquareX(from));
+        if (ambiguous && same_file)
+            san += static_cast<char>('8' - SquareY(from));
+
+        if (move.IsCapture())
+            san += 'x';
+        AppendSquare(san, to);
+    }
+
+    if (!mark_checks)
+        return san;
+
+    // A copy, so the caller's position and its history stay untouched.
+    ChessPosition after = position;
+    after.MakeMove(move);
+    if (after.IsInCheck()) {
+        ChessMoveList replies;
+        after.GenerateLegalMoves(replies);
+        san += replies.Size() ? '+' : '#';
+    }
+    return san;
+}
@@ -0,0 +1,15 @@
+#ifndef CHESS_SAN_H
+#define CHESS_SAN_H
+
+#include <string>
+
+#include "chess_position.h"
+
+// Standard algebraic notation of a legal move, e.g. "Nbd7", "exd6",
+// "e8=Q+" or "O-O#". Without `mark_checks` the '+' or '#' is left off,
+// which saves playing the move on a copy of the position; callers that
+// make the move anyway can add it themselves.
+std::string MoveToSan(const ChessPosition &position, const ChessMove &move,
+                      bool mark_checks = true);
+
+#endif
@@ -0,0 +1,392 @@
+#include "chess_search.h"
+#include "chess_eval.h"
+#include "chess_move_picker.h"
+#include "chess_stats.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static_assert(kMaxEvaluation < kMateInMaxPly,
+              "static scores must not read as mate scores");
+
+const int kAspirationDepth  = 4;
+const int kAspirationWindow = 25;
+const int kNullMoveDepth    = 3;
+const int kLmrDepth         = 3;
+const int kFutilityDepth    = 3;
+const int kFutilityMargin[kFutilityDepth + 1] = {0, 150, 300, 450};
+
+// Late move reductions by depth and move number, precomputed since the
+// formula takes two logarithms.
+struct ReductionTable {
+    int8_t reductions[64][64];
+
+    ReductionTable()
+    {
+        for (int depth = 0; depth < 64; ++depth)
+            for (int count = 0; count < 64; ++count)
+                reductions[depth][count] =
+                    depth && count
+                        ? 0.75 + log(depth) * log(count) / 2.25
+                        : 0;
+    }
+
+    int Get(int depth, int count) const
+    {
+        return reductions[depth < 63 ? depth : 63][count < 63 ? count : 63];
+    }
+};
+
+static const ReductionTable kReductions;
+
+bool SearchOptions::Disable(const char *name)
+{
+    if (!strcmp(name, "pvs"))
+        pvs = false;
+    else if (!strcmp(name, "aspiration"))
+        aspiration = false;
+    else if (!strcmp(name, "null-move"))
+        null_move = false;
+    else if (!strcmp(name, "lmr"))
+        lmr = false;
+    else if (!strcmp(name, "futility"))
+        futility = false;
+    else if (!strcmp(name, "all"))
+        *this = SearchOptions{false, false, false, false, false};
+    else
+        return false;
+    return true;
+}
+
+// Mate scores count plies from the root; the table stores them counted
+// from the position so they stay right wherever it is found again.
+static int ScoreToTable(int score, int ply)
+{
+    if (score >= kMateInMaxPly)
+        return score + ply;
+    if (score <= -kMateInMaxPly)
+        return score - ply;
+    return score;
+}
+
+static int ScoreFromTable(int score, int ply)
+{
+    if (score >= kMateInMaxPly)
+        return score - ply;
+    if (score <= -kMateInMaxPly)
+        return score + ply;
+    return score;
+}
+
+void FormatScore(int score, char *buf, int size)
+{
+    if (score >= kMateInMaxPly)
+        snprintf(buf, size, "mate %d", (kMateScore - score + 1) / 2);
+    else if (score <= -kMateInMaxPly)
+        snprintf(buf, size, "mate -%d", (kMateScore + score) / 2);
+    else
+        snprintf(buf, size, "cp %d", score);
+}
+
+SearchResult ChessSearch::Search(ChessPosition &position,
+                                 const SearchLimits &limits)
+{
+    SearchResult result;
+
+    this->limits = limits;
+    start_ns     = ChessStats::NowNs();
+    nodes        = 0;
+    cutoffs      = 0;
+    stopped      = false;
+    root_best    = ChessMove();
+    memset(killers, 0, sizeof(killers));
+    if (table)
+        table->NewSearch();
+
+    int max_depth = limits.depth < kMaxPly - 1 ? limits.depth : kMaxPly - 1;
+    for (int depth = 1; depth <= max_depth; ++depth) {
+        int score = SearchRoot(position, depth, result.score);
+
+        // A partial iteration still searched the previous best move first,
+        // so its best move is at least as good; the score is not reliable.
+        if (stopped) {
+            if (result.best_move.IsNull())
+                result.best_move = root_best;
+            break;
+        }
+
+        result.best_move = root_best;
+        result.score     = score;
+        result.depth     = depth;
+        if (progress) {
+            result.nodes   = nodes;
+            result.time_us = (ChessStats::NowNs() - start_ns) / 1000;
+            progress(result);
+        }
+
+        if (score >= kMateInMaxPly || score <= -kMateInMaxPly)
+            break;
+    }
+
+    result.nodes    = nodes;
+    result.time_us  = (ChessStats::NowNs() - start_ns) / 1000;
+    result.hashfull = table ? table->Hashfull() : 0;
+    ChessStats::Increment(ChessStats::SearchNodes, nodes);
+    ChessStats::Increment(ChessStats::SearchCutoffs, cutoffs);
+    return result;
+}
+
+int ChessSearch::SearchRoot(ChessPosition &position, int depth, int previous)
+{
+    if (!options.aspiration || depth < kAspirationDepth ||
+        abs(previous) >= kMateInMaxPly)
+        return AlphaBeta(position, -kInfinite, kInfinite, depth, 0);
+
+    // Most iterations end close to the previous score; a narrow window cuts
+    // more, and a fail widens it on that side until the score fits.
+    int delta = kAspirationWindow;
+    int alpha = previous - delta;
+    int beta  = previous + delta;
+
+    for (;;) {
+        int score = AlphaBeta(position, alpha, beta, depth, 0);
+        if (stopped)
+            return score;
+
+        if (score <= alpha)
+            alpha = alpha - delta > -kInfinite ? alpha - delta : -kInfinite;
+        else if (score >= beta)
+            beta = beta + delta < kInfinite ? beta + delta : kInfinite;
+        else
+            return score;
+
+        delta *= 2;
+    }
+}
+
+bool ChessSearch::ShouldStop()
+{
+    if (limits.nodes && nodes >= limits.nodes)
+        stopped = true;
+    else if (limits.time_ms && (nodes & 1023) == 0 &&
+             ChessStats::NowNs() - start_ns >= limits.time_ms * 1000000)
+        stopped = true;
+    return stopped;
+}
+
+int ChessSearch::AlphaBeta(ChessPosition &position, int alpha, int beta,
+                           int depth, int ply, bool allow_null)
+{
+    if (depth <= 0)
+        return Quiescence(position, alpha, beta, ply);
+
+    ++nodes;
+    if (ply > 0 && ShouldStop())
+        return 0;
+    if (ply > 0 && (position.IsRepetition() || position.IsFiftyMoveDraw()))
+        return 0;
+    if (ply >= kMaxPly - 1)
+        return StaticEval(position);
+
+    bool       pv_node    = beta - alpha > 1;
+    bool       in_check   = position.IsInCheck();
+    int        legal      = 0;
+    int        best_score = -kInfinite;
+    int        old_alpha  = alpha;
+    ChessMove  best_move, hash_move;
+    TableEntry entry;
+
+    // Searching checks one ply deeper keeps mates from hiding at the horizon.
+    // Extended before the probe, as entries are stored with this depth.
+    if (in_check)
+        ++depth;
+
+    if (table && table->Probe(position.GetKey(), entry)) {
+        int score = ScoreFromTable(entry.score, ply);
+        hash_move = entry.move;
+        if (!pv_node && entry.depth >= depth &&
+            (entry.bound == TableEntry::Exact ||
+             (entry.bound == TableEntry::Lower && score >= beta) ||
+             (entry.bound == TableEntry::Upper && score <= alpha)))
+            return score;
+    }
+
+    int static_eval = -kInfinite;
+    if (!pv_node && !in_check && (options.null_move || options.futility))
+        static_eval = StaticEval(position);
+
+    // If passing the turn still fails high on a reduced search, a real move
+    // almost certainly will too. Not done twice in a row, nor without
+    // pieces, where passing may be the best move.
+    if (options.null_move && allow_null && !pv_node && !in_check &&
+        depth >= kNullMoveDepth && static_eval >= beta &&
+        position.HasNonPawnMaterial(position.GetSideToMove())) {
+        int reduction = 3 + depth / 6;
+
+        position.MakeNullMove();
+        int score = -AlphaBeta(position, -beta, -beta + 1,
+                               depth - 1 - reduction, ply + 1, false);
+        position.UnmakeNullMove();
+
+        if (stopped)
+            return 0;
+        if (score >= beta) {
+            ++cutoffs;
+            return score >= kMateInMaxPly ? beta : score;
+        }
+    }
+
+    // Near the leaves, quiet moves cannot bring a position this far below
+    // alpha back up, so only captures, promotions and checks are searched.
+    bool futile = options.futility && !pv_node && !in_check &&
+                  depth <= kFutilityDepth && abs(alpha) < kMateInMaxPly &&
+                  static_eval + kFutilityMargin[depth] <= alpha;
+
+    // At the root the previous iteration's best move goes first.
+    MovePicker picker(position, ply == 0 ? root_best : hash_move,
+                      killers[ply]);
+
+    for (ChessMove move; !(move = picker.Next()).IsNull();) {
+        if (table)
+            table->Prefetch(position.KeyAfter(move));
+        position.MakeMove(move);
+        ++legal;
+
+        bool gives_check = position.IsInCheck();
+        bool killer      = move == killers[ply][0] || move == killers[ply][1];
+
+        // The first move is always searched so best_score is a real score.
+        if (futile && legal > 1 && move.IsQuiet() && !gives_check) {
+            position.UnmakeMove(move);
+            continue;
+        }
+
+        int score;
+        if (legal == 1) {
+            score = -AlphaBeta(position, -beta, -alpha, depth - 1, ply + 1);
+        } else {
+            int reduction = 0;
+            if (options.lmr && depth >= kLmrDepth && move.IsQuiet() &&
+                !killer && !in_check && !gives_check) {
+                reduction = kReductions.Get(depth, legal) - pv_node;
+                if (reduction > depth - 2)
+                    reduction = depth - 2;
+                if (reduction < 0)
+                    reduction = 0;
+            }
+
+            // A reduced or null-window search that beats alpha is repeated
+            // with the full depth, then with the full window.
+            bool full = true;
+            if (reduction) {
+                score = -AlphaBeta(position, -alpha - 1, -alpha,
+                                   depth - 1 - reduction, ply + 1);
+                full = score > alpha;
+            }
+            if (full && options.pvs) {
+                score = -AlphaBeta(position, -alpha - 1, -alpha, depth - 1,
+                                   ply + 1);
+                full = score > alpha && score < beta;
+            }
+            if (full)
+                score = -AlphaBeta(position, -beta, -alpha, depth - 1,
+                                   ply + 1);
+        }
+        position.UnmakeMove(move);
+
+        if (stopped)
+            return 0;
+
+        if (score > best_score) {
+            best_score = score;
+            best_move  = move;
+        }
+        if (score > alpha) {
+            // Only moves that beat alpha are known to be best; after an
+            // aspiration fail low the previous best stays first in line.
+            if (ply == 0)
+                root_best = move;
+            alpha = score;
+            if (alpha >= beta) {
+                ++cutoffs;
+                if (move.IsQuiet() && move != killers[ply][0]) {
+                    killers[ply][1] = killers[ply][0];
+                    killers[ply][0] = move;
+                }
+                break;
+            }
+        }
+    }
+
+    if (!legal)
+        return in_check ? -kMateScore + ply : 0;
+
+    if (table)
+        table->Store(position.GetKey(), best_move,
+                     ScoreToTable(best_score, ply), depth,
+                     best_score >= beta        ? TableEntry::Lower
+                     : best_score > old_alpha ? TableEntry::Exact
+                                               : TableEntry::Upper);
+    return best_score;
+}
+
+int ChessSearch::StaticEval(const ChessPosition &position)
+{
+    int score;
+    if (eval_cache && eval_cache->Probe(position.GetKey(), score))
+        return score;
+
+    score = Evaluate(position);
+    if (eval_cache)
+        eval_cache->Store(position.GetKey(), score);
+    return score;
+}
+
+int ChessSearch::Quiescence(ChessPosition &position, int alpha, int beta,
+                            int ply)
+{
+    ++nodes;
+    if (ShouldStop())
+        return 0;
+
+    if (ply >= kMaxPly - 1)
+        return StaticEval(position);
+
+    // In check there is no standing pat: every evasion is searched, and
+    // without one the side to move is mated.
+    bool in_check = position.IsInCheck();
+    if (!in_check) {
+        int stand_pat = StaticEval(position);
+        if (stand_pat >= beta)
+            return stand_pat;
+        if (stand_pat > alpha)
+            alpha = stand_pat;
+    }
+
+    MovePicker picker(position, ChessMove(), nullptr, !in_check);
+    int        legal = 0;
+
+    for (ChessMove move; !(move = picker.Next()).IsNull();) {
+        ++legal;
+        position.MakeMove(move);
+        int score = -Quiescence(position, -beta, -alpha, ply + 1);
+        position.UnmakeMove(move);
+
+        if (stopped)
+            return 0;
+
+        if (score > alpha) {
+            alpha = score;
+            if (alpha >= beta) {
+                ++cutoffs;
+                break;
+            }
+        }
+    }
+
+    if (in_check && !legal)
+        return -kMateScore + ply;
+    return alpha;
+}
@@ -0,0 +1,86 @@
+#ifndef CHESS_SEARCH_H
+#define CHESS_SEARCH_H
+
+#include <cstdint>
+#include <functional>
+
+#include "chess_position.h"
+#include "chess_tt.h"
+
+const int kMaxPly      = 128;
+const int kMateScore   = 32000;
+const int kInfinite    = 32001;
+const int kMateInMaxPly = kMateScore - kMaxPly;
+
+struct SearchLimits {
+    int      depth    = kMaxPly - 1;
+    uint64_t nodes    = 0; // 0 means no node limit
+    uint64_t time_ms  = 0; // 0 means no time limit
+};
+
+// Selective search techniques, each of which can be switched off to measure
+// what it buys. Null-move and futility pruning only act at null-window
+// nodes, so they prune much less with PVS off.
+struct SearchOptions {
+    bool pvs        = true; // null-window search after the first move
+    bool aspiration = true; // narrow root window around the last score
+    bool null_move  = true; // adaptive null-move pruning
+    bool lmr        = true; // late move reductions
+    bool futility   = true; // skip hopeless quiet moves near the leaves
+
+    // Switches off a technique by the name used in the comments above
+    // ("pvs", "aspiration", "null-move", "lmr", "futility"), or all of them
+    // for "all". False for an unknown name.
+    bool Disable(const char *name);
+};
+
+struct SearchResult {
+    ChessMove best_move;
+    int       score    = 0;
+    int       depth    = 0;
+    uint64_t  nodes    = 0;
+    uint64_t  time_us  = 0; // since the search started
+    int       hashfull = 0; // permille, 0 without a table
+};
+
+// Iterative deepening alpha-beta search. One instance per thread: it keeps
+// per-search state such as killer moves and node counts.
+class ChessSearch {
+public:
+    void SetOptions(const SearchOptions &options) { this->options = options; }
+    // The table may be shared by several searches; none when null.
+    void SetTable(TranspositionTable *table) { this->table = table; }
+    // Likewise for static evaluations.
+    void SetEvalCache(EvalCache *eval_cache) { this->eval_cache = eval_cache; }
+
+    // Called with the result so far after every completed iteration.
+    typedef std::function<void(const SearchResult &result)> Progress;
+    void SetProgress(const Progress &progress) { this->progress = progress; }
+
+    SearchResult Search(ChessPosition &position, const SearchLimits &limits);
+
+private:
+    SearchOptions       options;
+    TranspositionTable *table      = nullptr;
+    EvalCache          *eval_cache = nullptr;
+    Progress            progress;
+    SearchLimits        limits;
+    uint64_t            start_ns;
+    uint64_t            nodes;
+    uint64_t            cutoffs;
+    bool                stopped;
+    ChessMove           root_best;
+    ChessMove           killers[kMaxPly][2];
+
+    int  SearchRoot(ChessPosition &position, int depth, int previous);
+    int  AlphaBeta(ChessPosition &position, int alpha, int beta, int depth,
+                   int ply, bool allow_null = true);
+    int  Quiescence(ChessPosition &position, int alpha, int beta, int ply);
+    int  StaticEval(const ChessPosition &position);
+    bool ShouldStop();
+};
+
+// Formats a score as "cp N" or "mate N" (moves, negative when being mated).
+void FormatScore(int score, char *buf, int size);
+
+#endif
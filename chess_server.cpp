@@ -0,0 +1,392 @@
+#include "chess_server.h"
+#include "chess_stats.h"
+
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+const int    kMaxEvents  = 256;
+const size_t kMaxLine    = 256;
+const size_t kMaxOutput  = 1 << 20;
+const size_t kReadBuffer = 16384;
+
+ChessServer::ChessServer()
+{
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    wake_fd  = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epoll_fd >= 0 && wake_fd >= 0)
+        AddToEpoll(wake_fd, EPOLLIN);
+}
+
+ChessServer::~ChessServer()
+{
+    for (Connection *conn : connections)
+        if (conn)
+            CloseConnection(conn);
+
+    if (listen_fd >= 0)
+        close(listen_fd);
+    if (wake_fd >= 0)
+        close(wake_fd);
+    if (epoll_fd >= 0)
+        close(epoll_fd);
+}
+
+bool ChessServer::Listen(const char *address)
+{
+    if (epoll_fd < 0 || wake_fd < 0 || listen_fd >= 0)
+        return false;
+
+    bool success = address[0] == ':' ? ListenTcp(atoi(address + 1))
+                                     : ListenUnix(address);
+
+    if (success && !AddToEpoll(listen_fd, EPOLLIN)) {
+        close(listen_fd);
+        listen_fd = -1;
+        success   = false;
+    }
+    return success;
+}
+
+bool ChessServer::ListenUnix(const char *path)
+{
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path))
+        return false;
+    strcpy(addr.sun_path, path);
+
+    listen_fd =
+        socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd < 0)
+        return false;
+
+    unlink(path);
+    if (bind(listen_fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) <
+            0 ||
+        listen(listen_fd, SOMAXCONN) < 0) {
+        close(listen_fd);
+        listen_fd = -1;
+        return false;
+    }
+    return true;
+}
+
+bool ChessServer::ListenTcp(int port)
+{
+    if (port <= 0 || port > 65535)
+        return false;
+
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_port        = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    listen_fd =
+        socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd < 0)
+        return false;
+
+    int one = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (bind(listen_fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) <
+            0 ||
+        listen(listen_fd, SOMAXCONN) < 0) {
+        close(listen_fd);
+        listen_fd = -1;
+        return false;
+    }
+    return true;
+}
+
+bool ChessServer::AddToEpoll(int fd, uint32_t events)
+{
+    epoll_event event;
+    event.events  = events;
+    event.data.fd = fd;
+    return epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) == 0;
+}
+
+void ChessServer::Stop()
+{
+    uint64_t one = 1;
+    if (write(wake_fd, &one, sizeof(one)) < 0) {
+        // Counter already non-zero; the loop is being woken anyway.
+    }
+}
+
+void ChessServer::Run()
+{
+    epoll_event events[kMaxEvents];
+    bool        running = listen_fd >= 0;
+
+    while (running) {
+        int count = epoll_wait(epoll_fd, events, kMaxEvents, -1);
+        if (count < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+
+        for (int i = 0; i < count; ++i) {
+            int fd = events[i].data.fd;
+
+            if (fd == wake_fd) {
+                running = false;
+            } else if (fd == listen_fd) {
+                Accept();
+            } else if (fd < static_cast<int>(connections.size()) &&
+                       connections[fd]) {
+                Connection *conn = connections[fd];
+                if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+                    HandleReadable(conn);
+                else if (events[i].events & EPOLLOUT)
+                    Flush(conn);
+
+                if (conn->closing && conn->out_buf.empty())
+                    CloseConnection(conn);
+            }
+        }
+    }
+}
+
+void ChessServer::Accept()
+{
+    for (;;) {
+        int fd = accept4(listen_fd, nullptr, nullptr,
+                         SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+            break;
+
+        // Only meaningful for TCP; fails harmlessly on Unix sockets.
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        if (!AddToEpoll(fd, EPOLLIN)) {
+            close(fd);
+            continue;
+        }
+
+        if (fd >= static_cast<int>(connections.size()))
+            connections.resize(fd + 1, nullptr);
+
+        Connection *conn  = new Connection;
+        conn->fd          = fd;
+        connections[fd]   = conn;
+        ++connection_count;
+    }
+}
+
+void ChessServer::HandleReadable(Connection *conn)
+{
+    char    buf[kReadBuffer];
+    ssize_t len = read(conn->fd, buf, sizeof(buf));
+
+    if (len <= 0) {
+        if (len < 0 && (errno == EAGAIN || errno == EINTR))
+            return;
+        conn->closing = true;
+        conn->out_buf.clear();
+        return;
+    }
+
+    uint64_t read_ns = ChessStats::NowNs();
+
+    conn->in_buf.append(buf, len);
+
+    size_t start = 0, end;
+    while (!conn->closing &&
+           (end = conn->in_buf.find('\n', start)) != std::string::npos) {
+        conn->in_buf[end] = '\0';
+        HandleLine(conn, &conn->in_buf[start]);
+        start = end + 1;
+    }
+    conn->in_buf.erase(0, start);
+
+    if (conn->in_buf.size() > kMaxLine) {
+        conn->out_buf += "error line too long\n";
+        conn->closing = true;
+    }
+
+    Flush(conn);
+
+    // Every move answered from this read is acknowledged once its reply
+    // has been handed to the kernel.
+    uint64_t ack_ns = ChessStats::NowNs() - read_ns;
+    for (; conn->pending_acks > 0; --conn->pending_acks)
+        ChessStats::RecordTime(ChessStats::MoveAck, ack_ns);
+}
+
+GameSession *ChessServer::FindGame(const char *id_str, uint64_t &id)
+{
+    if (!id_str)
+        return nullptr;
+
+    char *end;
+    errno = 0;
+    id    = strtoull(id_str, &end, 10);
+    if (errno || *end)
+        return nullptr;
+
+    return sessions.Get(id);
+}
+
+void ChessServer::HandleLine(Connection *conn, char *line)
+{
+    char *saveptr;
+    char *command = strtok_r(line, " \t\r", &saveptr);
+    char *arg1    = strtok_r(nullptr, " \t\r", &saveptr);
+    char *arg2    = strtok_r(nullptr, " \t\r", &saveptr);
+    char  reply[96];
+
+    if (!command)
+        return;
+
+    uint64_t     id;
+    GameSession *game = nullptr;
+
+    if (!strcmp(command, "move")) {
+        int from_x, from_y, to_x, to_y;
+
+        ++conn->pending_acks;
+        if (!(game = FindGame(arg1, id))) {
+            conn->out_buf += "error no such game\n";
+        } else if (game->owner_fd != conn->fd) {
+            conn->out_buf += "error not your game\n";
+        } else if (!arg2 || strlen(arg2) != 4 ||
+                   !ParseSquare(arg2, from_x, from_y) ||
+                   !ParseSquare(arg2 + 2, to_x, to_y)) {
+            conn->out_buf += "error bad move\n";
+        } else if (game->board.MovePiece(game->team_current_turn, from_x,
+                                         from_y, to_x, to_y,
+                                         game->history)) {
+            game->team_current_turn = game->team_current_turn == TeamID::White
+                                          ? TeamID::Black
+                                          : TeamID::White;
+            conn->out_buf += "ok\n";
+        } else {
+            conn->out_buf += "illegal\n";
+        }
+    } else if (!strcmp(command, "undo")) {
+        if (!(game = FindGame(arg1, id))) {
+            conn->out_buf += "error no such game\n";
+        } else if (game->owner_fd != conn->fd) {
+            conn->out_buf += "error not your game\n";
+        } else if (game->board.UndoMove(game->history)) {
+            game->team_current_turn = game->team_current_turn == TeamID::White
+                                          ? TeamID::Black
+                                          : TeamID::White;
+            conn->out_buf += "ok\n";
+        } else {
+            conn->out_buf += "error nothing to undo\n";
+        }
+    } else if (!strcmp(command, "new")) {
+        sessions.Allocate(id, conn->fd);
+        conn->games.push_back(id);
+        snprintf(reply, sizeof(reply), "ok %llu\n",
+                 static_cast<unsigned long long>(id));
+        conn->out_buf += reply;
+    } else if (!strcmp(command, "board")) {
+        if (!(game = FindGame(arg1, id))) {
+            conn->out_buf += "error no such game\n";
+        } else {
+            char *p = reply;
+            p += sprintf(p, "ok ");
+            for (int y = 0; y < kBoardSize; ++y)
+                for (int x = 0; x < kBoardSize; ++x)
+                    *p++ = game->board.GetCellChar(x, y);
+            sprintf(p, " %c\n",
+                    game->team_current_turn == TeamID::White ? 'w' : 'b');
+            conn->out_buf += reply;
+        }
+    } else if (!strcmp(command, "close")) {
+        if (!(game = FindGame(arg1, id))) {
+            conn->out_buf += "error no such game\n";
+        } else if (game->owner_fd != conn->fd) {
+            conn->out_buf += "error not your game\n";
+        } else {
+            for (size_t i = 0; i < conn->games.size(); ++i) {
+                if (conn->games[i] == id) {
+                    conn->games[i] = conn->games.back();
+                    conn->games.pop_back();
+                    break;
+                }
+            }
+            sessions.Free(id);
+            conn->out_buf += "ok\n";
+        }
+    } else if (!strcmp(command, "stats")) {
+        ChessStats::Snapshot     snapshot;
+        std::vector<std::string> lines;
+
+        ChessStats::Collect(snapshot);
+        ChessStats::Format(snapshot, lines);
+        for (const std::string &stat : lines)
+            conn->out_buf += "stat " + stat + "\n";
+        snprintf(reply, sizeof(reply), "ok games=%u connections=%d\n",
+                 sessions.Size(), connection_count);
+        conn->out_buf += reply;
+    } else if (!strcmp(command, "quit")) {
+        conn->closing = true;
+    } else {
+        conn->out_buf += "error unknown command\n";
+    }
+}
+
+void ChessServer::Flush(Connection *conn)
+{
+    while (!conn->out_buf.empty()) {
+        ssize_t len = send(conn->fd, conn->out_buf.data(),
+                           conn->out_buf.size(), MSG_NOSIGNAL);
+        if (len < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN) {
+                conn->out_buf.clear();
+                conn->closing = true;
+            }
+            break;
+        }
+        conn->out_buf.erase(0, len);
+    }
+
+    // A client that never reads its replies is cut off instead of growing
+    // the buffer without bound.
+    if (conn->out_buf.size() > kMaxOutput) {
+        conn->out_buf.clear();
+        conn->closing = true;
+    }
+
+    bool want_write = !conn->out_buf.empty();
+    if (want_write != conn->want_write) {
+        epoll_event event;
+        event.events  = want_write ? EPOLLIN | EPOLLOUT : EPOLLIN;
+        event.data.fd = conn->fd;
+        epoll_ctl(epoll_fd, EPOLL_CTL_MOD, conn->fd, &event);
+        conn->want_write = want_write;
+    }
+}
+
+void ChessServer::CloseConnection(Connection *conn)
+{
+    for (uint64_t id : conn->games)
+        sessions.Free(id);
+
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, conn->fd, nullptr);
+    close(conn->fd);
+    connections[conn->fd] = nullptr;
+    --connection_count;
+    delete conn;
+}
@@ -0,0 +1,80 @@
+#ifndef CHESS_SERVER_H
+#define CHESS_SERVER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "chess_board.h"
+#include "chess_pieces.h"
+#include "chess_slab.h"
+
+struct GameSession {
+    TeamID      team_current_turn = TeamID::White;
+    MoveHistory history;
+    ChessBoard  board;
+    int         owner_fd;
+
+    GameSession(int owner_fd) : owner_fd(owner_fd) {}
+};
+
+// Hosts many games in one process behind a single-threaded, non-blocking
+// epoll loop. One request per line, one response line per request:
+//
+//   new                  -> ok <game>
+//   move <game> e2e4     -> ok | illegal
+//   undo <game>          -> ok | error nothing to undo
+//   board <game>         -> ok <64 cells, rank 8 first> <w|b>
+//   close <game>         -> ok
+//   stats                -> stat <line>... then ok games=N connections=N
+//   quit                 -> connection is closed
+//
+// Failures answer "error <reason>". A game belongs to the connection that
+// created it: others may look at its board, but move, undo and close answer
+// "error not your game". Games are freed by "close" or when their
+// connection goes away.
+class ChessServer {
+    struct Connection {
+        int                   fd;
+        std::string           in_buf;
+        std::string           out_buf;
+        std::vector<uint64_t> games;
+        bool                  want_write = false;
+        bool                  closing    = false;
+        int                   pending_acks = 0;
+    };
+
+    int listen_fd = -1;
+    int epoll_fd  = -1;
+    int wake_fd   = -1;
+
+    // Indexed by fd, so lookups on every event are a plain array access.
+    std::vector<Connection *>  connections;
+    int                        connection_count = 0;
+    SlabAllocator<GameSession> sessions;
+
+public:
+    ChessServer();
+    ~ChessServer();
+
+    // "PATH" listens on a Unix-domain socket, ":PORT" on loopback TCP.
+    bool Listen(const char *address);
+    void Run();
+    // Safe to call from another thread or a signal handler.
+    void Stop();
+
+private:
+    bool ListenUnix(const char *path);
+    bool ListenTcp(int port);
+    bool AddToEpoll(int fd, uint32_t events);
+
+    void Accept();
+    void HandleReadable(Connection *conn);
+    void HandleLine(Connection *conn, char *line);
+    void Flush(Connection *conn);
+    void CloseConnection(Connection *conn);
+
+    GameSession *FindGame(const char *id_str, uint64_t &id);
+};
+
+#endif
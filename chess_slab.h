@@ -0,0 +1,136 @@
+#ifndef CHESS_SLAB_H
+#define CHESS_SLAB_H
+
+#include <cstdint>
+#include <new>
+#include <utility>
+#include <vector>
+
+// Fixed-size object pool. Objects live in slabs of kSlabObjects slots that
+// are never moved or returned to the system, so pointers stay valid until
+// Free(). Handles carry a generation counter, so a handle to a freed and
+// reused slot is rejected instead of aliasing the new object.
+template <class T>
+class SlabAllocator {
+    static const uint32_t kSlabObjects = 256;
+    static const uint32_t kNoSlot      = 0xffffffff;
+
+    struct Slot {
+        alignas(T) unsigned char storage[sizeof(T)];
+        uint32_t generation = 0;
+        uint32_t next_free  = kNoSlot;
+        bool     used       = false;
+
+        T *Object() { return reinterpret_cast<T *>(storage); }
+    };
+
+    std::vector<Slot *> slabs;
+    uint32_t            free_head = kNoSlot;
+    uint32_t            used_count = 0;
+
+public:
+    SlabAllocator() {}
+    SlabAllocator(const SlabAllocator &) = delete;
+    SlabAllocator &operator=(const SlabAllocator &) = delete;
+    ~SlabAllocator();
+
+    template <class... Args>
+    T *Allocate(uint64_t &handle, Args &&...args);
+    T *Get(uint64_t handle);
+    bool Free(uint64_t handle);
+
+    uint32_t Size() const { return used_count; }
+    uint32_t Capacity() const { return slabs.size() * kSlabObjects; }
+
+private:
+    Slot *SlotAt(uint32_t index)
+    {
+        return &slabs[index / kSlabObjects][index % kSlabObjects];
+    }
+    Slot *SlotFor(uint64_t handle);
+    void  Grow();
+};
+
+template <class T>
+SlabAllocator<T>::~SlabAllocator()
+{
+    for (Slot *slab : slabs) {
+        for (uint32_t i = 0; i < kSlabObjects; ++i)
+            if (slab[i].used)
+                slab[i].Object()->~T();
+        delete[] slab;
+    }
+}
+
+template <class T>
+template <class... Args>
+T *SlabAllocator<T>::Allocate(uint64_t &handle, Args &&...args)
+{
+    if (free_head == kNoSlot)
+        Grow();
+
+    uint32_t index = free_head;
+    Slot    *slot  = SlotAt(index);
+    free_head      = slot->next_free;
+
+    T *object  = new (slot->storage) T(std::forward<Args>(args)...);
+    slot->used = true;
+    ++used_count;
+
+    handle = (uint64_t(slot->generation) << 32) | index;
+    return object;
+}
+
+template <class T>
+T *SlabAllocator<T>::Get(uint64_t handle)
+{
+    Slot *slot = SlotFor(handle);
+    return slot ? slot->Object() : nullptr;
+}
+
+template <class T>
+bool SlabAllocator<T>::Free(uint64_t handle)
+{
+    Slot *slot = SlotFor(handle);
+    if (!slot)
+        return false;
+
+    slot->Object()->~T();
+    slot->used = false;
+    ++slot->generation;
+    slot->next_free = free_head;
+    free_head       = static_cast<uint32_t>(handle);
+    --used_count;
+    return true;
+}
+
+template <class T>
+typename SlabAllocator<T>::Slot *SlabAllocator<T>::SlotFor(uint64_t handle)
+{
+    uint32_t index      = static_cast<uint32_t>(handle);
+    uint32_t generation = static_cast<uint32_t>(handle >> 32);
+
+    if (index >= Capacity())
+        return nullptr;
+
+    Slot *slot = SlotAt(index);
+    if (!slot->used || slot->generation != generation)
+        return nullptr;
+    return slot;
+}
+
+template <class T>
+void SlabAllocator<T>::Grow()
+{
+    uint32_t base = Capacity();
+    Slot    *slab = new Slot[kSlabObjects];
+
+    // Chain the new slots so the lowest index is handed out first.
+    for (uint32_t i = 0; i < kSlabObjects; ++i)
+        slab[i].next_free = i + 1 < kSlabObjects ? base + i + 1 : free_head;
+
+    slabs.push_back(slab);
+    free_head = base;
+}
+
+#endif
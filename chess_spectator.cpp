@@ -0,0 +1,280 @@
+#include "chess_spectator.h"
+#include "chess_board.h"
+#include "chess_stats.h"
+
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+// Board tiles are 20x10 plus a status line, bare ones 8x8 plus the line;
+// both are spaced out by a blank column or two.
+const int kFullTileWidth    = 20;
+const int kFullTileStepX    = 21;
+const int kFullTileStepY    = 11;
+const int kCompactTileWidth = 8;
+const int kCompactTileStepX = 10;
+const int kCompactTileStepY = 9;
+
+void BoardSnapshot::Fill(int game, int ply, const ChessPosition &position,
+                         Status status)
+{
+    this->game   = game;
+    this->ply    = ply;
+    this->status = status;
+    for (int square = 0; square < 64; ++square)
+        squares[square] = position.GetPiece(square);
+}
+
+SnapshotQueue::SnapshotQueue(size_t capacity)
+{
+    size_t size = 1;
+    while (size < capacity)
+        size <<= 1;
+
+    slots.reset(new Slot[size]);
+    mask = size - 1;
+    for (size_t i = 0; i < size; ++i)
+        slots[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+// A slot is free for position `pos` when its sequence equals pos, and holds
+// the snapshot for `pos` once the sequence is pos + 1. Reading it hands it
+// on to position pos + size.
+bool SnapshotQueue::TryPush(const BoardSnapshot &snapshot)
+{
+    uint64_t pos = head.load(std::memory_order_relaxed);
+    Slot    *slot;
+
+    for (;;) {
+        slot          = &slots[pos & mask];
+        uint64_t seq  = slot->sequence.load(std::memory_order_acquire);
+        int64_t  diff = static_cast<int64_t>(seq - pos);
+
+        if (diff == 0) {
+            if (head.compare_exchange_weak(pos, pos + 1,
+                                           std::memory_order_relaxed))
+                break;
+        } else if (diff < 0) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        } else {
+            pos = head.load(std::memory_order_relaxed);
+        }
+    }
+
+    slot->snapshot = snapshot;
+    slot->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+bool SnapshotQueue::TryPop(BoardSnapshot &snapshot)
+{
+    uint64_t pos  = tail.load(std::memory_order_relaxed);
+    Slot    &slot = slots[pos & mask];
+
+    if (slot.sequence.load(std::memory_order_acquire) != pos + 1)
+        return false;
+
+    snapshot = slot.snapshot;
+    slot.sequence.store(pos + mask + 1, std::memory_order_release);
+    tail.store(pos + 1, std::memory_order_relaxed);
+    return true;
+}
+
+SpectatorView::SpectatorView(int boards, int fps)
+    : queue(boards * 16), tiles(boards), fps(fps > 0 ? fps : 1)
+{
+    ChessBoard::InitColors();
+    Layout();
+}
+
+SpectatorView::~SpectatorView()
+{
+    for (Tile &tile : tiles)
+        if (tile.window)
+            delwin(tile.window);
+    if (header)
+        delwin(header);
+}
+
+// (Re)creates the windows for the current screen size; every tile is drawn
+// in full on the next frame.
+void SpectatorView::Layout()
+{
+    for (Tile &tile : tiles) {
+        if (tile.window)
+            delwin(tile.window);
+        tile.window = nullptr;
+        tile.drawn  = false;
+    }
+    if (header)
+        delwin(header);
+
+    header = newwin(1, COLS, 0, 0);
+    nodelay(header, true);
+
+    int boards = static_cast<int>(tiles.size());
+    int rows   = LINES - 1;
+
+    compact    = (COLS / kFullTileStepX) * (rows / kFullTileStepY) < boards;
+    int width  = compact ? kCompactTileWidth : kFullTileWidth;
+    int step_x = compact ? kCompactTileStepX : kFullTileStepX;
+    int step_y = compact ? kCompactTileStepY : kFullTileStepY;
+
+    int per_row  = COLS / step_x;
+    int per_col  = rows / step_y;
+    shown_boards = per_row * per_col < boards ? per_row * per_col : boards;
+
+    for (int i = 0; i < shown_boards; ++i)
+        tiles[i].window = newwin(step_y, width, 1 + (i / per_row) * step_y,
+                                 (i % per_row) * step_x);
+
+    clear();
+    wnoutrefresh(stdscr);
+}
+
+void SpectatorView::DrawHeader()
+{
+    werase(header);
+    mvwprintw(header, 0, 0,
+              "%d games, %d shown, %d fps max, %llu frames, %llu dropped%s",
+              static_cast<int>(tiles.size()), shown_boards, fps,
+              static_cast<unsigned long long>(frames),
+              static_cast<unsigned long long>(queue.GetDropped()),
+              finished ? " - all finished, q to quit" : " - q to quit");
+    wnoutrefresh(header);
+}
+
+void SpectatorView::DrawCell(Tile &tile, int square)
+{
+    int       x    = SquareX(square);
+    int       y    = SquareY(square);
+    PieceCode code = tile.latest.squares[square];
+    char      ch   = ' ';
+    int       color_pair;
+
+    if (code != kNoPiece) {
+        ch         = kPieceChars[PieceCodeID(code)];
+        color_pair = (PieceCodeTeam(code) == TeamID::White ? 1 : 3) +
+                     ((x + y) % 2 == 0);
+    } else {
+        color_pair = ((x + y) % 2 == 0) + 1;
+    }
+
+    wattrset(tile.window, COLOR_PAIR(color_pair) | A_BOLD);
+    if (compact)
+        mvwaddch(tile.window, y, x, ch);
+    else
+        mvwprintw(tile.window, 1 + y, 2 + x * 2, " %c", ch);
+    wattrset(tile.window, A_NORMAL);
+
+    tile.shown[square] = code;
+}
+
+void SpectatorView::DrawTile(int index, Tile &tile)
+{
+    WINDOW *window = tile.window;
+
+    if (!tile.drawn) {
+        werase(window);
+        if (!compact) {
+            wattrset(window, COLOR_PAIR(5) | A_BOLD);
+            for (int y = 0; y < kBoardSize + 2; ++y)
+                mvwhline(window, y, 0, ' ', kFullTileWidth);
+            for (int i = 0; i < kBoardSize; ++i) {
+                mvwaddch(window, i + 1, 1, '8' - i);
+                mvwaddch(window, 0, (i * 2) + 3, i + 'a');
+            }
+            wattrset(window, COLOR_PAIR(6) | A_BOLD);
+            for (int i = 0; i < kBoardSize; ++i) {
+                mvwaddch(window, i + 1, 19, '8' - i);
+                mvwaddch(window, 9, (i * 2) + 3, i + 'a');
+            }
+            wattrset(window, A_NORMAL);
+        }
+        // Nothing matches a code outside the piece range, so every cell
+        // and the status line get drawn below.
+        memset(tile.shown, -1, sizeof(tile.shown));
+        tile.shown_ply = -1;
+        tile.drawn     = true;
+    }
+
+    for (int square = 0; square < 64; ++square)
+        if (tile.latest.squares[square] != tile.shown[square])
+            DrawCell(tile, square);
+
+    if (tile.latest.ply != tile.shown_ply ||
+        tile.latest.status != tile.shown_status) {
+        static const char *const kResults[] = {"", "1-0", "0-1", "1/2"};
+
+        int  row = compact ? kBoardSize : kBoardSize + 2;
+        char status[24];
+        if (tile.latest.status == BoardSnapshot::Playing)
+            snprintf(status, sizeof(status), "%d %d", index + 1,
+                     tile.latest.ply);
+        else
+            snprintf(status, sizeof(status), "%d %s", index + 1,
+                     kResults[tile.latest.status]);
+
+        wmove(window, row, 0);
+        wclrtoeol(window);
+        mvwaddnstr(window, row, 0, status, getmaxx(window));
+        tile.shown_ply    = tile.latest.ply;
+        tile.shown_status = tile.latest.status;
+    }
+
+    tile.dirty = false;
+    wnoutrefresh(window);
+}
+
+void SpectatorView::Frame()
+{
+    ScopedStatsTimer timer(ChessStats::SpectatorFrame);
+    BoardSnapshot    snapshot;
+
+    // Each game's snapshots come from one thread in order, so the last
+    // one popped is the newest and the ones before it are never drawn.
+    while (queue.TryPop(snapshot)) {
+        if (snapshot.game < 0 ||
+            snapshot.game >= static_cast<int>(tiles.size()))
+            continue;
+        tiles[snapshot.game].latest = snapshot;
+        tiles[snapshot.game].dirty  = true;
+    }
+
+    for (int i = 0; i < shown_boards; ++i)
+        if (tiles[i].dirty || !tiles[i].drawn)
+            DrawTile(i, tiles[i]);
+
+    ++frames;
+    DrawHeader();
+    doupdate();
+}
+
+void SpectatorView::Run(const std::function<bool()> &finished)
+{
+    const uint64_t frame_ns = 1000000000ull / fps;
+    uint64_t       next_ns  = ChessStats::NowNs();
+
+    for (;;) {
+        // Checked before the frame, so it includes the games' last moves.
+        if (!this->finished && finished())
+            this->finished = true;
+        Frame();
+
+        for (int key; (key = wgetch(header)) != ERR;) {
+            if (key == 'q')
+                return;
+            if (key == KEY_RESIZE)
+                Layout();
+        }
+
+        next_ns += frame_ns;
+        uint64_t now_ns = ChessStats::NowNs();
+        if (next_ns > now_ns)
+            std::this_thread::sleep_for(
+                std::chrono::nanoseconds(next_ns - now_ns));
+        else
+            next_ns = now_ns; // behind: do not try to catch up
+    }
+}
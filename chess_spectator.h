@@ -0,0 +1,115 @@
+#ifndef CHESS_SPECTATOR_H
+#define CHESS_SPECTATOR_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <ncurses.h>
+#include <vector>
+
+#include "chess_position.h"
+
+// A game as the spectator view shows it, taken by the game's own thread
+// after every move.
+struct BoardSnapshot {
+    enum Status { Playing, WhiteWins, BlackWins, Drawn };
+
+    int       game   = 0;
+    int       ply    = 0;
+    Status    status = Playing;
+    PieceCode squares[64] = {}; // board layout of chess_position.h
+
+    void Fill(int game, int ply, const ChessPosition &position,
+              Status status);
+};
+
+// Bounded multi-producer, single-consumer ring where every slot carries a
+// sequence number, so producers claim slots with one compare-and-swap and
+// never wait on each other or on the consumer. A push onto a full queue
+// fails; game threads drop the snapshot, since the next one of the same
+// game supersedes it.
+class SnapshotQueue {
+public:
+    // Capacity is rounded up to a power of two.
+    explicit SnapshotQueue(size_t capacity);
+
+    SnapshotQueue(const SnapshotQueue &)            = delete;
+    SnapshotQueue &operator=(const SnapshotQueue &) = delete;
+
+    bool TryPush(const BoardSnapshot &snapshot);
+    // Consumer side only.
+    bool TryPop(BoardSnapshot &snapshot);
+
+    uint64_t GetDropped() const
+    {
+        return dropped.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> sequence;
+        BoardSnapshot         snapshot;
+    };
+
+    std::unique_ptr<Slot[]> slots;
+    uint64_t                mask;
+
+    alignas(64) std::atomic<uint64_t> head{0}; // next slot to fill
+    alignas(64) std::atomic<uint64_t> tail{0}; // next slot to read
+    std::atomic<uint64_t> dropped{0};
+};
+
+// Tiles boards into one ncurses window each, under a one-line header. A
+// tile is the usual bordered 20x10 board when all of them fit on the
+// screen and a bare 8x8 one otherwise; boards that still do not fit are
+// not shown. Only cells that differ from what the tile shows are redrawn,
+// and the screen is updated once per frame.
+//
+// Curses must be initialized; the view sets up its own color pairs.
+class SpectatorView {
+public:
+    SpectatorView(int boards, int fps);
+    ~SpectatorView();
+
+    SpectatorView(const SpectatorView &)            = delete;
+    SpectatorView &operator=(const SpectatorView &) = delete;
+
+    SnapshotQueue &GetQueue() { return queue; }
+
+    // Takes in every queued snapshot and draws what changed.
+    void Frame();
+    // Draws frames at no more than the frame rate until `q` is pressed.
+    // Once `finished` returns true the header says so; the view stays up
+    // until `q` all the same.
+    void Run(const std::function<bool()> &finished);
+
+    int GetShownBoards() const { return shown_boards; }
+
+private:
+    struct Tile {
+        WINDOW               *window = nullptr;
+        BoardSnapshot         latest;
+        PieceCode             shown[64];
+        int                   shown_ply    = -1;
+        BoardSnapshot::Status shown_status = BoardSnapshot::Playing;
+        bool                  drawn        = false;
+        bool                  dirty        = false;
+    };
+
+    SnapshotQueue     queue;
+    std::vector<Tile> tiles;
+    WINDOW           *header = nullptr;
+    int               fps;
+    int               shown_boards = 0;
+    bool              compact      = false;
+    bool              finished     = false;
+    uint64_t          frames       = 0;
+
+    void Layout();
+    void DrawHeader();
+    void DrawTile(int index, Tile &tile);
+    void DrawCell(Tile &tile, int square);
+};
+
+#endif
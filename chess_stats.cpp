@@ -0,0 +1,220 @@
+#include "chess_stats.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+
+static const char *kCounterNames[ChessStats::CounterCount] = {
+    "moves_validated",
+    "moves_rejected",
+    "search_nodes",
+    "search_cutoffs",
+    "cache_checked",
+    "cache_dropped",
+};
+
+static const char *kTimerNames[ChessStats::TimerCount] = {
+    "checkmate_check",
+    "frame_render",
+    "input_to_render",
+    "move_ack",
+    "input_to_move",
+    "spectator_frame",
+};
+
+// Only the owning thread writes these, so a relaxed load + store is enough
+// and avoids a locked instruction on the hot path; readers may see a value
+// that is one update behind.
+typedef std::atomic<uint64_t> StatCell;
+
+static void Bump(StatCell &cell, uint64_t n)
+{
+    cell.store(cell.load(std::memory_order_relaxed) + n,
+               std::memory_order_relaxed);
+}
+
+struct ThreadHistogram {
+    StatCell buckets[ChessStats::kHistogramBuckets] = {};
+    StatCell count                                  = {0};
+    StatCell sum_ns                                 = {0};
+    StatCell max_ns                                 = {0};
+};
+
+struct ThreadStats {
+    StatCell        counters[ChessStats::CounterCount] = {};
+    ThreadHistogram timers[ChessStats::TimerCount];
+};
+
+static void AddTo(ChessStats::Snapshot &snapshot, const ThreadStats &stats)
+{
+    for (int i = 0; i < ChessStats::CounterCount; ++i)
+        snapshot.counters[i] +=
+            stats.counters[i].load(std::memory_order_relaxed);
+
+    for (int t = 0; t < ChessStats::TimerCount; ++t) {
+        ChessStats::Histogram &dst = snapshot.timers[t];
+        const ThreadHistogram &src = stats.timers[t];
+        for (int b = 0; b < ChessStats::kHistogramBuckets; ++b)
+            dst.buckets[b] += src.buckets[b].load(std::memory_order_relaxed);
+        dst.count += src.count.load(std::memory_order_relaxed);
+        dst.sum_ns += src.sum_ns.load(std::memory_order_relaxed);
+
+        uint64_t max_ns = src.max_ns.load(std::memory_order_relaxed);
+        if (max_ns > dst.max_ns)
+            dst.max_ns = max_ns;
+    }
+}
+
+class StatsRegistry {
+public:
+    std::mutex                mutex;
+    std::vector<ThreadStats *> live;
+    ChessStats::Snapshot      retired;
+
+    StatsRegistry() { memset(&retired, 0, sizeof(retired)); }
+};
+
+static StatsRegistry &Registry()
+{
+    static StatsRegistry registry;
+    return registry;
+}
+
+class ThreadStatsHandle {
+public:
+    ThreadStats stats;
+
+    ThreadStatsHandle()
+    {
+        StatsRegistry              &registry = Registry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        registry.live.push_back(&stats);
+    }
+
+    ~ThreadStatsHandle()
+    {
+        StatsRegistry              &registry = Registry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        AddTo(registry.retired, stats);
+        for (size_t i = 0; i < registry.live.size(); ++i) {
+            if (registry.live[i] == &stats) {
+                registry.live[i] = registry.live.back();
+                registry.live.pop_back();
+                break;
+            }
+        }
+    }
+};
+
+static ThreadStats &LocalStats()
+{
+    thread_local ThreadStatsHandle handle;
+    return handle.stats;
+}
+
+static int BucketIndex(uint64_t ns)
+{
+    int index = ns ? 64 - __builtin_clzll(ns) : 0;
+    return index < ChessStats::kHistogramBuckets
+               ? index
+               : ChessStats::kHistogramBuckets - 1;
+}
+
+uint64_t ChessStats::Histogram::Percentile(double p) const
+{
+    if (!count)
+        return 0;
+
+    uint64_t target = static_cast<uint64_t>(p * count + 0.5);
+    if (target < 1)
+        target = 1;
+
+    uint64_t seen = 0;
+    for (int b = 0; b < kHistogramBuckets; ++b) {
+        seen += buckets[b];
+        if (seen >= target) {
+            uint64_t upper = b ? uint64_t(1) << b : 0;
+            return upper < max_ns ? upper : max_ns;
+        }
+    }
+    return max_ns;
+}
+
+void ChessStats::Increment(Counter counter, uint64_t n)
+{
+    Bump(LocalStats().counters[counter], n);
+}
+
+void ChessStats::RecordTime(Timer timer, uint64_t ns)
+{
+    ThreadHistogram &histogram = LocalStats().timers[timer];
+
+    Bump(histogram.buckets[BucketIndex(ns)], 1);
+    Bump(histogram.count, 1);
+    Bump(histogram.sum_ns, ns);
+    if (ns > histogram.max_ns.load(std::memory_order_relaxed))
+        histogram.max_ns.store(ns, std::memory_order_relaxed);
+}
+
+void ChessStats::Collect(Snapshot &snapshot)
+{
+    StatsRegistry              &registry = Registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    snapshot = registry.retired;
+    for (const ThreadStats *stats : registry.live)
+        AddTo(snapshot, *stats);
+}
+
+void ChessStats::Format(const Snapshot &snapshot,
+                        std::vector<std::string> &lines)
+{
+    char line[128];
+
+    for (int i = 0; i < CounterCount; ++i) {
+        snprintf(line, sizeof(line), "%-16s %llu", kCounterNames[i],
+                 static_cast<unsigned long long>(snapshot.counters[i]));
+        lines.push_back(line);
+    }
+
+    for (int t = 0; t < TimerCount; ++t) {
+        const Histogram &h = snapshot.timers[t];
+        snprintf(line, sizeof(line),
+                 "%-16s n=%llu mean=%.1fus p50<=%.1fus p99<=%.1fus "
+                 "max=%.1fus",
+                 kTimerNames[t], static_cast<unsigned long long>(h.count),
+                 h.count ? h.sum_ns / 1000.0 / h.count : 0.0,
+                 h.Percentile(0.50) / 1000.0, h.Percentile(0.99) / 1000.0,
+                 h.max_ns / 1000.0);
+        lines.push_back(line);
+    }
+}
+
+void ChessStats::Dump(FILE *out)
+{
+    Snapshot                 snapshot;
+    std::vector<std::string> lines;
+
+    Collect(snapshot);
+    Format(snapshot, lines);
+    for (const std::string &line : lines)
+        fprintf(out, "%s\n", line.c_str());
+}
+
+uint64_t ChessStats::NowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+const char *ChessStats::CounterName(Counter counter)
+{
+    return kCounterNames[counter];
+}
+
+const char *ChessStats::TimerName(Timer timer)
+{
+    return kTimerNames[timer];
+}
@@ -0,0 +1,78 @@
+#ifndef CHESS_STATS_H
+#define CHESS_STATS_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Each thread bumps its own counters without locking; Collect() merges
+// all live threads (plus the ones that already exited) on demand.
+class ChessStats {
+public:
+    enum Counter {
+        MovesValidated,
+        MovesRejected,
+        SearchNodes,
+        SearchCutoffs,
+        CacheBlocksChecked,
+        CacheBlocksDropped,
+        CounterCount
+    };
+    enum Timer {
+        CheckMateTime,
+        FrameRender,
+        InputToRender,
+        MoveAck,
+        InputToMove,
+        SpectatorFrame,
+        TimerCount
+    };
+
+    // Log2 buckets of nanoseconds: bucket i holds [2^(i-1), 2^i).
+    static const int kHistogramBuckets = 40;
+
+    struct Histogram {
+        uint64_t buckets[kHistogramBuckets];
+        uint64_t count;
+        uint64_t sum_ns;
+        uint64_t max_ns;
+
+        uint64_t Percentile(double p) const;
+    };
+
+    struct Snapshot {
+        uint64_t  counters[CounterCount];
+        Histogram timers[TimerCount];
+    };
+
+    static void Increment(Counter counter, uint64_t n = 1);
+    static void RecordTime(Timer timer, uint64_t ns);
+
+    static void Collect(Snapshot &snapshot);
+    static void Format(const Snapshot &snapshot,
+                       std::vector<std::string> &lines);
+    static void Dump(FILE *out);
+
+    static uint64_t NowNs();
+
+    static const char *CounterName(Counter counter);
+    static const char *TimerName(Timer timer);
+};
+
+class ScopedStatsTimer {
+    ChessStats::Timer timer;
+    uint64_t          start_ns;
+
+public:
+    ScopedStatsTimer(ChessStats::Timer timer)
+        : timer(timer), start_ns(ChessStats::NowNs())
+    {
+    }
+    ~ScopedStatsTimer()
+    {
+        ChessStats::RecordTime(timer, ChessStats::NowNs() - start_ns);
+    }
+};
+
+#endif
@@ -0,0 +1,84 @@
+#include "chess_thread_pool.h"
+
+WorkStealingPool::WorkStealingPool(int threads)
+{
+    if (threads < 1)
+        threads = 1;
+
+    for (int i = 0; i < threads; ++i)
+        queues.emplace_back(new WorkerQueue);
+    for (int i = 0; i < threads; ++i)
+        workers.emplace_back(&WorkStealingPool::WorkerLoop, this, i);
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        shutting_down = true;
+    }
+    wake.notify_all();
+
+    for (std::thread &worker : workers)
+        worker.join();
+}
+
+int WorkStealingPool::DefaultThreads()
+{
+    unsigned threads = std::thread::hardware_concurrency();
+    return threads ? threads : 1;
+}
+
+void WorkStealingPool::Submit(Task task)
+{
+    unsigned     index = next_queue++ % queues.size();
+    WorkerQueue &queue = *queues[index];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+    }
+    {
+        // Counted under the sleep lock so a worker checking for work
+        // cannot miss this task and go to sleep on it.
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        ++pending;
+    }
+    wake.notify_one();
+}
+
+bool WorkStealingPool::TryPop(int index, Task &task)
+{
+    int count = static_cast<int>(queues.size());
+
+    // Own queue first, then the others starting from the next worker so
+    // thieves spread out instead of all hitting worker 0. Both take the
+    // oldest task, which keeps results close to submission order.
+    for (int i = 0; i < count; ++i) {
+        WorkerQueue                &queue = *queues[(index + i) % count];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty()) {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            --pending;
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::WorkerLoop(int index)
+{
+    Task task;
+
+    for (;;) {
+        if (TryPop(index, task)) {
+            task(index);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleep_mutex);
+        wake.wait(lock, [this]() { return pending > 0 || shutting_down; });
+        if (shutting_down && pending == 0)
+            break;
+    }
+}
@@ -0,0 +1,48 @@
+#ifndef CHESS_THREAD_POOL_H
+#define CHESS_THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Each worker owns a task queue; an idle worker steals from the others
+// before going to sleep. Tasks get the index of the worker running them so
+// callers can keep per-thread state in a plain vector.
+class WorkStealingPool {
+public:
+    typedef std::function<void(int worker)> Task;
+
+    WorkStealingPool(int threads);
+    // Runs every task already submitted, then joins the workers.
+    ~WorkStealingPool();
+
+    void Submit(Task task);
+    int  Size() const { return static_cast<int>(workers.size()); }
+
+    static int DefaultThreads();
+
+private:
+    struct WorkerQueue {
+        std::mutex       mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::vector<std::thread>                  workers;
+
+    std::mutex              sleep_mutex;
+    std::condition_variable wake;
+    std::atomic<int>        pending{0};
+    std::atomic<unsigned>   next_queue{0};
+    bool                    shutting_down = false;
+
+    bool TryPop(int index, Task &task);
+    void WorkerLoop(int index);
+};
+
+#endif
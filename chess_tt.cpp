@@ -0,0 +1,277 @@
+#include "chess_tt.h"
+
+#include <algorithm>
+#include <cstring>
+#include <sys/mman.h>
+#include <thread>
+#include <vector>
+
+const size_t kHugePageSize = 2 << 20;
+// Clearing is split between threads above this many bytes per thread.
+const size_t kClearChunk = 256 << 20;
+
+TranspositionTable::~TranspositionTable()
+{
+    Free();
+}
+
+void TranspositionTable::Free()
+{
+    if (page_kind == MappedFile)
+        file.Close();
+    else if (clusters)
+        munmap(clusters, size_bytes);
+    clusters      = nullptr;
+    cluster_count = 0;
+    size_bytes    = 0;
+    page_kind     = NoPages;
+}
+
+// Anonymous memory aligned to a huge page, so the kernel can back all of it
+// with transparent huge pages.
+static void *MapAligned(size_t bytes)
+{
+    size_t padded = bytes + kHugePageSize;
+    char  *memory = static_cast<char *>(mmap(nullptr, padded,
+                                             PROT_READ | PROT_WRITE,
+                                             MAP_PRIVATE | MAP_ANONYMOUS, -1,
+                                             0));
+    if (memory == MAP_FAILED)
+        return nullptr;
+
+    char *aligned = reinterpret_cast<char *>(
+        (reinterpret_cast<uintptr_t>(memory) + kHugePageSize - 1) &
+        ~uintptr_t(kHugePageSize - 1));
+    if (aligned > memory)
+        munmap(memory, aligned - memory);
+    if (memory + padded > aligned + bytes)
+        munmap(aligned + bytes, memory + padded - (aligned + bytes));
+    return aligned;
+}
+
+bool TranspositionTable::Resize(size_t megabytes)
+{
+    Free();
+
+    size_t bytes = ((megabytes << 20) + kHugePageSize - 1) &
+                   ~(kHugePageSize - 1);
+    if (!bytes)
+        return true;
+
+    PageKind kind   = HugePages;
+    void    *memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (memory == MAP_FAILED) {
+        memory = MapAligned(bytes);
+        if (!memory)
+            return false;
+        kind = madvise(memory, bytes, MADV_HUGEPAGE) == 0
+                   ? TransparentHugePages
+                   : SmallPages;
+    }
+
+    clusters      = static_cast<Cluster *>(memory);
+    cluster_count = bytes / sizeof(Cluster);
+    size_bytes    = bytes;
+    page_kind     = kind;
+
+    Clear();
+    return true;
+}
+
+void TranspositionTable::Clear()
+{
+    generation.store(0, std::memory_order_relaxed);
+    if (!clusters)
+        return;
+    if (page_kind == MappedFile) {
+        memset(clusters, 0, size_bytes);
+        file.MarkAllValid();
+        return;
+    }
+
+    // Writing every page also faults the table in now rather than during
+    // the first search; big tables are shared out between threads.
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    size_t   chunk   = std::max(kClearChunk, size_bytes / threads);
+    chunk            = (chunk + kHugePageSize - 1) & ~(kHugePageSize - 1);
+
+    char                    *base = reinterpret_cast<char *>(clusters);
+    std::vector<std::thread> workers;
+    for (size_t start = chunk; start < size_bytes; start += chunk) {
+        size_t length = std::min(chunk, size_bytes - start);
+        workers.emplace_back([=]() { memset(base + start, 0, length); });
+    }
+    memset(base, 0, std::min(chunk, size_bytes));
+
+    for (std::thread &worker : workers)
+        worker.join();
+}
+
+bool TranspositionTable::Save(const char *path, uint64_t fingerprint)
+{
+    if (!clusters)
+        return false;
+    // Blocks not yet checked could be corrupt; saving would vouch for them.
+    if (page_kind == MappedFile)
+        file.ValidateAll();
+    return CacheFile::Save(path, CacheFile::TranspositionTableKind,
+                           sizeof(Cluster), fingerprint, Generation(),
+                           clusters, size_bytes);
+}
+
+bool TranspositionTable::Load(const char *path, uint64_t fingerprint)
+{
+    CacheFile loaded;
+    if (!loaded.Open(path, CacheFile::TranspositionTableKind,
+                     sizeof(Cluster), fingerprint) ||
+        loaded.GetSize() % sizeof(Cluster))
+        return false;
+
+    Free();
+    file.Swap(loaded);
+    clusters      = static_cast<Cluster *>(file.GetData());
+    size_bytes    = file.GetSize();
+    cluster_count = size_bytes / sizeof(Cluster);
+    page_kind     = MappedFile;
+    generation.store(static_cast<uint8_t>(file.GetOwnerValue()),
+                     std::memory_order_relaxed);
+    return true;
+}
+
+bool TranspositionTable::Probe(uint64_t key, TableEntry &result) const
+{
+    if (!clusters)
+        return false;
+
+    Validate(Index(key));
+    const Cluster &cluster = clusters[Index(key)];
+    uint16_t       key16   = static_cast<uint16_t>(key);
+
+    for (const Entry &entry : cluster.entries) {
+        if (entry.key16 != key16 || !(entry.generation_bound & 3))
+            continue;
+
+        result.move  = ChessMove::FromRaw(entry.move_low |
+                                          uint32_t(entry.move_high) << 16);
+        result.score = entry.score;
+        result.depth = entry.depth;
+        result.bound = static_cast<TableEntry::Bound>(entry.generation_bound &
+                                                      3);
+        return true;
+    }
+    return false;
+}
+
+void TranspositionTable::Store(uint64_t key, const ChessMove &move, int score,
+                               int depth, TableEntry::Bound bound)
+{
+    if (!clusters)
+        return;
+
+    Validate(Index(key));
+    Cluster &cluster = clusters[Index(key)];
+    uint16_t key16   = static_cast<uint16_t>(key);
+    Entry   *replace = &cluster.entries[0];
+
+    // Entries fill up in order, so an empty one ends the search. Otherwise
+    // the shallowest entry goes, with every search of age counting as 8
+    // plies less.
+    for (Entry &entry : cluster.entries) {
+        if (entry.key16 == key16 || !(entry.generation_bound & 3)) {
+            replace = &entry;
+            break;
+        }
+        if (entry.depth - 8 * Age(entry) < replace->depth - 8 * Age(*replace))
+            replace = &entry;
+    }
+
+    bool same = replace->key16 == key16 && (replace->generation_bound & 3);
+
+    // A much deeper result for the same position from this search is worth
+    // more than a shallow bound.
+    if (same && bound != TableEntry::Exact && Age(*replace) == 0 &&
+        depth + 2 < replace->depth)
+        return;
+
+    // Keep the old best move when this search found none.
+    if (!move.IsNull() || !same) {
+        replace->move_low  = static_cast<uint16_t>(move.ToRaw());
+        replace->move_high = static_cast<uint16_t>(move.ToRaw() >> 16);
+    }
+    replace->key16            = key16;
+    replace->score            = static_cast<int16_t>(score);
+    replace->depth            = static_cast<int8_t>(depth < 127 ? depth : 127);
+    replace->generation_bound = static_cast<uint8_t>(Generation() << 2 | bound);
+}
+
+int TranspositionTable::Hashfull() const
+{
+    if (!clusters)
+        return 0;
+
+    uint64_t sample = cluster_count < 1000 ? cluster_count : 1000;
+    int      used   = 0;
+    for (uint64_t i = 0; i < sample; ++i) {
+        Validate(i);
+        for (const Entry &entry : clusters[i].entries)
+            if ((entry.generation_bound & 3) && Age(entry) == 0)
+                ++used;
+    }
+
+    return used * 1000 / (sample * kClusterEntries);
+}
+
+bool EvalCache::Resize(size_t megabytes)
+{
+    size_t slot_count = (megabytes << 20) / sizeof(uint64_t);
+    size_t size       = 1;
+    while (size * 2 <= slot_count)
+        size *= 2;
+
+    file.Close();
+    owned.assign(slot_count ? size : 0, 0);
+    slots = owned.empty() ? nullptr : owned.data();
+    mask  = owned.empty() ? 0 : size - 1;
+    return true;
+}
+
+void EvalCache::Clear()
+{
+    if (!slots)
+        return;
+    memset(slots, 0, (mask + 1) * sizeof(uint64_t));
+    if (file.IsOpen())
+        file.MarkAllValid();
+}
+
+bool EvalCache::Save(const char *path, uint64_t fingerprint)
+{
+    if (!slots)
+        return false;
+    if (file.IsOpen())
+        file.ValidateAll();
+    return CacheFile::Save(path, CacheFile::EvalCacheKind, sizeof(uint64_t),
+                           fingerprint, 0, slots,
+                           (mask + 1) * sizeof(uint64_t));
+}
+
+bool EvalCache::Load(const char *path, uint64_t fingerprint)
+{
+    CacheFile loaded;
+    if (!loaded.Open(path, CacheFile::EvalCacheKind, sizeof(uint64_t),
+                     fingerprint))
+        return false;
+
+    // The index is a mask, so the slot count must be a power of two.
+    size_t slot_count = loaded.GetSize() / sizeof(uint64_t);
+    if (loaded.GetSize() % sizeof(uint64_t) || (slot_count & (slot_count - 1)))
+        return false;
+
+    owned.clear();
+    owned.shrink_to_fit();
+    file.Swap(loaded);
+    slots = static_cast<uint64_t *>(file.GetData());
+    mask  = slot_count - 1;
+    return true;
+}
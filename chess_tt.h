@@ -0,0 +1,174 @@
+#ifndef CHESS_TT_H
+#define CHESS_TT_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "chess_cache_file.h"
+#include "chess_position.h"
+
+// What a table entry knows about a searched position. Mate scores are
+// stored as distance from the position, which the search converts.
+struct TableEntry {
+    enum Bound { NoBound, Upper, Lower, Exact };
+
+    ChessMove move;
+    int       score = 0;
+    int       depth = 0;
+    Bound     bound = NoBound;
+};
+
+// Shared hash table of search results. Buckets are 64-byte clusters of six
+// 10-byte entries, so a probe touches a single cache line. Entries keep
+// the low 16 bits of the key; the cluster comes from the high bits.
+//
+// Threads may probe and store concurrently without locking: a torn entry
+// at worst gives a wrong move or score, and moves are only ever matched
+// against generated ones. Resize, Clear, Load and Save must not overlap a
+// search.
+class TranspositionTable {
+public:
+    enum PageKind {
+        NoPages,
+        SmallPages,
+        TransparentHugePages,
+        HugePages,
+        MappedFile
+    };
+
+    TranspositionTable() = default;
+    ~TranspositionTable();
+
+    TranspositionTable(const TranspositionTable &)            = delete;
+    TranspositionTable &operator=(const TranspositionTable &) = delete;
+
+    // Reallocates for `megabytes` (rounded up to 2 MB) and clears. Tries
+    // explicit huge pages first, then asks for transparent ones.
+    bool     Resize(size_t megabytes);
+    void     Clear();
+    size_t   GetSizeMb() const { return size_bytes >> 20; }
+    PageKind GetPageKind() const { return page_kind; }
+
+    // A saved table carries the evaluation fingerprint it was filled with
+    // and is only loaded back under the same one. Loading maps the file, so
+    // the table is usable at once; clusters are checked on first touch and
+    // cleared if corrupt. Its size is that of the file.
+    bool Save(const char *path, uint64_t fingerprint);
+    bool Load(const char *path, uint64_t fingerprint);
+
+    // Call once per search so older entries are the first to go.
+    void NewSearch() { generation.fetch_add(1, std::memory_order_relaxed); }
+
+    void Prefetch(uint64_t key) const
+    {
+        if (clusters)
+            __builtin_prefetch(&clusters[Index(key)]);
+    }
+    bool Probe(uint64_t key, TableEntry &entry) const;
+    void Store(uint64_t key, const ChessMove &move, int score, int depth,
+               TableEntry::Bound bound);
+
+    // Permille of a sample of entries that were written by this search.
+    int Hashfull() const;
+
+private:
+    struct Entry {
+        uint16_t key16;
+        uint16_t move_low, move_high;
+        int16_t  score;
+        int8_t   depth;
+        uint8_t  generation_bound; // generation << 2 | bound
+    };
+
+    static const int     kClusterEntries = 6;
+    static const uint8_t kGenerationMask = 63;
+
+    struct alignas(64) Cluster {
+        Entry entries[kClusterEntries];
+        char  padding[64 - kClusterEntries * sizeof(Entry)];
+    };
+    static_assert(sizeof(Cluster) == 64, "a cluster is one cache line");
+
+    Cluster *clusters      = nullptr;
+    uint64_t cluster_count = 0;
+    size_t   size_bytes    = 0;
+    PageKind page_kind     = NoPages;
+    // Wraps freely; only the low six bits are stored.
+    std::atomic<uint8_t> generation{0};
+    // Backs the table when it was loaded; checking is what changes.
+    mutable CacheFile file;
+
+    uint64_t Index(uint64_t key) const
+    {
+        return static_cast<uint64_t>(
+            (static_cast<unsigned __int128>(key) * cluster_count) >> 64);
+    }
+    uint8_t Generation() const
+    {
+        return generation.load(std::memory_order_relaxed) & kGenerationMask;
+    }
+    int Age(const Entry &entry) const
+    {
+        return (Generation() - (entry.generation_bound >> 2)) &
+               kGenerationMask;
+    }
+    void Validate(uint64_t index) const
+    {
+        if (page_kind == MappedFile)
+            file.Validate(index * sizeof(Cluster));
+    }
+    void Free();
+};
+
+// Static evaluations by position key, one 64-bit word per slot: the high 48
+// bits of the key and the score. Words are read and written whole, so
+// threads share the cache without locking or torn entries. Collisions
+// simply replace.
+class EvalCache {
+public:
+    // Slots are rounded down to a power of two.
+    bool   Resize(size_t megabytes);
+    void   Clear();
+    size_t GetSizeMb() const { return (mask + 1) * sizeof(uint64_t) >> 20; }
+
+    // Same contract as TranspositionTable's.
+    bool Save(const char *path, uint64_t fingerprint);
+    bool Load(const char *path, uint64_t fingerprint);
+
+    bool Probe(uint64_t key, int &score) const
+    {
+        if (!slots)
+            return false;
+        if (file.IsOpen())
+            file.Validate((key & mask) * sizeof(uint64_t));
+
+        uint64_t word = __atomic_load_n(&slots[key & mask], __ATOMIC_RELAXED);
+        if ((word ^ key) >> 16)
+            return false;
+        score = int(word & 0xffff) - 32768;
+        return true;
+    }
+    void Store(uint64_t key, int score)
+    {
+        if (!slots)
+            return;
+        if (file.IsOpen())
+            file.Validate((key & mask) * sizeof(uint64_t));
+
+        // Evaluate keeps scores in range; anything else must not wrap.
+        if (score < -32768 || score > 32767)
+            return;
+        uint64_t word = (key & ~uint64_t(0xffff)) | uint16_t(score + 32768);
+        __atomic_store_n(&slots[key & mask], word, __ATOMIC_RELAXED);
+    }
+
+private:
+    std::vector<uint64_t> owned;
+    uint64_t             *slots = nullptr;
+    uint64_t              mask  = 0;
+    mutable CacheFile     file;
+};
+
+#endif
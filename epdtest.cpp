@@ -0,0 +1,359 @@
+#include "chess_epd.h"
+#include "chess_json.h"
+#include "chess_position.h"
+#include "chess_san.h"
+#include "chess_search.h"
+#include "chess_thread_pool.h"
+#include "chess_tt.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// A position counts as solved when the search ends on a bm move (or on
+// none of the am moves). Its time to solution is when the search settled
+// on that answer: the end of the first iteration after which the best
+// move stayed right until the end of the search.
+struct PositionResult {
+    std::string id;
+    bool        valid  = false;
+    bool        solved = false;
+    std::string move; // SAN
+    double      tts_ms = -1;
+    uint64_t    nodes  = 0;
+    int         depth  = 0;
+};
+
+struct BaselineEntry {
+    bool   solved;
+    double tts_ms;
+};
+
+static bool IsCorrect(const ChessPosition &position, const EpdRecord &record,
+                      const ChessMove &move)
+{
+    if (move.IsNull())
+        return false;
+    for (const std::string &best : record.best_moves)
+        if (MoveMatches(position, move, best))
+            return true;
+    for (const std::string &avoid : record.avoid_moves)
+        if (MoveMatches(position, move, avoid))
+            return false;
+    return record.best_moves.empty();
+}
+
+static void RunPosition(const EpdRecord &record, const SearchLimits &limits,
+                        ChessPosition &position, ChessSearch &search,
+                        TranspositionTable *table, PositionResult &result)
+{
+    result.id = record.id;
+    if (!position.SetFromFen(record.fen.c_str()))
+        return;
+    result.valid = true;
+
+    // Each position starts from an empty table, so results do not depend
+    // on which worker got it or what that worker searched before.
+    if (table)
+        table->Clear();
+
+    uint64_t settled_us = 0;
+    bool     settled    = false;
+    search.SetProgress([&](const SearchResult &progress) {
+        bool correct = IsCorrect(position, record, progress.best_move);
+        if (correct && !settled)
+            settled_us = progress.time_us;
+        settled = correct;
+    });
+
+    SearchResult found = search.Search(position, limits);
+    search.SetProgress(nullptr);
+
+    result.solved = IsCorrect(position, record, found.best_move);
+    result.move   = found.best_move.IsNull()
+                        ? "-"
+                        : MoveToSan(position, found.best_move);
+    result.nodes  = found.nodes;
+    result.depth  = found.depth;
+    if (result.solved)
+        result.tts_ms = (settled ? settled_us : found.time_us) / 1000.0;
+}
+
+// Reads a JSON string that JsonEscape wrote, from just past its opening
+// quote; `p` is left past the closing one. False if the line ends first.
+static bool ReadJsonString(const char *&p, std::string &str)
+{
+    str.clear();
+    for (; *p && *p != '"'; ++p) {
+        if (*p != '\\') {
+            str += *p;
+        } else if (p[1] == 'u' && strlen(p) >= 6) {
+            str += static_cast<char>(strtol(std::string(p + 2, 4).c_str(),
+                                            nullptr, 16));
+            p += 5;
+        } else if (p[1]) {
+            str += *++p;
+        }
+    }
+    if (*p != '"')
+        return false;
+    ++p;
+    return true;
+}
+
+// Reads what WriteJson wrote: one position object per line.
+static bool ReadBaseline(const char *path,
+                         std::map<std::string, BaselineEntry> &baseline)
+{
+    FILE *in = fopen(path, "r");
+    if (!in)
+        return false;
+
+    char        line[512], solved[8];
+    std::string id;
+    while (fgets(line, sizeof(line), in)) {
+        BaselineEntry entry;
+        const char   *p = strstr(line, "{\"id\": \"");
+        if (!p)
+            continue;
+        p += 8;
+        if (!ReadJsonString(p, id) ||
+            sscanf(p, ", \"solved\": %7[a-z]", solved) != 1)
+            continue;
+
+        const char *tts = strstr(p, "\"tts_ms\": ");
+        entry.solved    = !strcmp(solved, "true");
+        entry.tts_ms    = tts ? atof(tts + 10) : -1;
+        baseline[id]    = entry;
+    }
+
+    fclose(in);
+    return true;
+}
+
+static void WriteJson(FILE *out, const char *suite, const char *budget,
+                      const std::vector<PositionResult> &results, int solved)
+{
+    fprintf(out, "{\n  \"suite\": \"%s\",\n  \"budget\": \"%s\",\n",
+            JsonEscape(suite).c_str(), JsonEscape(budget).c_str());
+    fprintf(out, "  \"solved\": %d,\n  \"total\": %zu,\n  \"positions\": [\n",
+            solved, results.size());
+    for (size_t i = 0; i < results.size(); ++i) {
+        const PositionResult &r = results[i];
+        fprintf(out,
+                "    {\"id\": \"%s\", \"solved\": %s, \"move\": \"%s\", "
+                "\"tts_ms\": %.2f, \"nodes\": %llu, \"depth\": %d}%s\n",
+                JsonEscape(r.id).c_str(), r.solved ? "true" : "false",
+                JsonEscape(r.move).c_str(),
+                r.tts_ms, static_cast<unsigned long long>(r.nodes), r.depth,
+                i + 1 < results.size() ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+}
+
+// Positions that the baseline solved and this run did not, or solved more
+// than `slower` times as slowly (with 10 ms of slack for timer noise).
+static int CompareBaseline(const std::map<std::string, BaselineEntry> &baseline,
+                           const std::vector<PositionResult> &results,
+                           double slower)
+{
+    int regressions = 0;
+
+    for (const PositionResult &r : results) {
+        auto it = baseline.find(r.id);
+        if (it == baseline.end() || !it->second.solved)
+            continue;
+
+        if (!r.solved) {
+            printf("regression %s: solved in %.1f ms by the baseline, not "
+                   "solved now\n",
+                   r.id.c_str(), it->second.tts_ms);
+            ++regressions;
+        } else if (r.tts_ms > it->second.tts_ms * slower + 10) {
+            printf("regression %s: %.1f ms to solve, %.1f ms in the "
+                   "baseline\n",
+                   r.id.c_str(), r.tts_ms, it->second.tts_ms);
+            ++regressions;
+        }
+    }
+    return regressions;
+}
+
+static void PrintUsage()
+{
+    fprintf(stderr,
+            "usage: epdtest FILE [--movetime MS] [--nodes N] [--depth N]\n"
+            "               [--threads N] [--hash MB] [--json FILE]\n"
+            "               [--baseline FILE] [--slower FACTOR]\n");
+}
+
+int main(int argc, char **argv)
+{
+    SearchLimits limits;
+    int          threads       = 0;
+    size_t       hash_mb       = 16;
+    const char  *json_path     = nullptr;
+    const char  *baseline_path = nullptr;
+    double       slower        = 2.0;
+
+    if (argc < 2) {
+        PrintUsage();
+        return 1;
+    }
+    for (int i = 2; i < argc; ++i) {
+        if (i + 1 >= argc) {
+            PrintUsage();
+            return 1;
+        }
+        if (!strcmp(argv[i], "--movetime")) {
+            limits.time_ms = strtoull(argv[++i], nullptr, 10);
+        } else if (!strcmp(argv[i], "--nodes")) {
+            limits.nodes = strtoull(argv[++i], nullptr, 10);
+        } else if (!strcmp(argv[i], "--depth")) {
+            limits.depth = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--threads")) {
+            threads = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--hash")) {
+            hash_mb = strtoull(argv[++i], nullptr, 10);
+        } else if (!strcmp(argv[i], "--json")) {
+            json_path = argv[++i];
+        } else if (!strcmp(argv[i], "--baseline")) {
+            baseline_path = argv[++i];
+        } else if (!strcmp(argv[i], "--slower")) {
+            slower = atof(argv[++i]);
+        } else {
+            PrintUsage();
+            return 1;
+        }
+    }
+    if (limits.depth < 1) {
+        PrintUsage();
+        return 1;
+    }
+    // Without a budget every position would search to the maximum depth.
+    if (!limits.time_ms && !limits.nodes && limits.depth >= kMaxPly - 1)
+        limits.time_ms = 1000;
+    if (threads < 1)
+        threads = WorkStealingPool::DefaultThreads();
+
+    FILE *in = fopen(argv[1], "r");
+    if (!in) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    std::vector<EpdRecord> records;
+    char                   line[1024];
+    for (int number = 1; fgets(line, sizeof(line), in); ++number) {
+        EpdRecord record;
+        line[strcspn(line, "\r\n")] = '\0';
+        if (!line[strspn(line, " \t")] || line[0] == '#')
+            continue;
+        if (!ParseEpd(line, record)) {
+            fprintf(stderr, "%s:%d: not an EPD record\n", argv[1], number);
+            continue;
+        }
+        if (record.id.empty())
+            record.id = "line " + std::to_string(number);
+        records.push_back(record);
+    }
+    fclose(in);
+
+    std::map<std::string, BaselineEntry> baseline;
+    if (baseline_path && !ReadBaseline(baseline_path, baseline)) {
+        perror(baseline_path);
+        return 1;
+    }
+
+    // Engine state is per worker. Positions are independent, so with a
+    // time budget the only interaction is sharing the cores.
+    std::vector<std::unique_ptr<ChessPosition>>      positions;
+    std::vector<std::unique_ptr<ChessSearch>>        searches;
+    std::vector<std::unique_ptr<TranspositionTable>> tables;
+    for (int i = 0; i < threads; ++i) {
+        positions.emplace_back(new ChessPosition);
+        searches.emplace_back(new ChessSearch);
+        tables.emplace_back(hash_mb ? new TranspositionTable : nullptr);
+        if (tables.back() && tables.back()->Resize(hash_mb))
+            searches.back()->SetTable(tables.back().get());
+        else
+            tables.back().reset();
+    }
+
+    std::vector<PositionResult> results(records.size());
+    {
+        WorkStealingPool pool(threads);
+        for (size_t i = 0; i < records.size(); ++i)
+            pool.Submit([&, i](int worker) {
+                RunPosition(records[i], limits, *positions[worker],
+                            *searches[worker], tables[worker].get(),
+                            results[i]);
+            });
+    }
+
+    int    solved = 0;
+    double tts_sum = 0;
+    printf("%-16s %-6s %-8s %-16s %10s %12s %5s\n", "id", "result", "move",
+           "expected", "tts ms", "nodes", "depth");
+    for (size_t i = 0; i < results.size(); ++i) {
+        const PositionResult &r = results[i];
+        std::string expected;
+        for (const std::string &move : records[i].best_moves)
+            expected += (expected.empty() ? "" : " ") + move;
+        for (const std::string &move : records[i].avoid_moves)
+            expected += (expected.empty() ? "!" : " !") + move;
+
+        if (!r.valid) {
+            printf("%-16s %-6s\n", r.id.c_str(), "badfen");
+            continue;
+        }
+        if (r.solved) {
+            ++solved;
+            tts_sum += r.tts_ms;
+        }
+        char tts[32] = "-";
+        if (r.solved)
+            snprintf(tts, sizeof(tts), "%.1f", r.tts_ms);
+        printf("%-16s %-6s %-8s %-16s %10s %12llu %5d\n", r.id.c_str(),
+               r.solved ? "ok" : "fail", r.move.c_str(), expected.c_str(),
+               tts, static_cast<unsigned long long>(r.nodes), r.depth);
+    }
+
+    char budget[64];
+    if (limits.nodes)
+        snprintf(budget, sizeof(budget), "nodes %llu",
+                 static_cast<unsigned long long>(limits.nodes));
+    else if (limits.time_ms)
+        snprintf(budget, sizeof(budget), "movetime %llu",
+                 static_cast<unsigned long long>(limits.time_ms));
+    else
+        snprintf(budget, sizeof(budget), "depth %d", limits.depth);
+
+    printf("solved %d/%zu (%.1f%%), mean time to solution %.1f ms, %s, "
+           "%d threads\n",
+           solved, results.size(),
+           results.empty() ? 0.0 : 100.0 * solved / results.size(),
+           solved ? tts_sum / solved : 0.0, budget, threads);
+
+    if (json_path) {
+        FILE *out = !strcmp(json_path, "-") ? stdout : fopen(json_path, "w");
+        if (!out) {
+            perror(json_path);
+            return 1;
+        }
+        WriteJson(out, argv[1], budget, results, solved);
+        if (out != stdout)
+            fclose(out);
+    }
+
+    if (baseline_path) {
+        int regressions = CompareBaseline(baseline, results, slower);
+        printf("%d regressions against %s\n", regressions, baseline_path);
+        return regressions ? 2 : 0;
+    }
+    return 0;
+}
@@ -1,8 +1,387 @@
+#include "chess_analysis.h"
 #include "chess_game.h"
+#include "chess_headless.h"
+#include "chess_input.h"
+#include "chess_mate.h"
+#include "chess_server.h"
+#include "chess_spectator.h"
+#include "chess_stats.h"
 
-int main()
+#include <atomic>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+static ChessServer *gServer = nullptr;
+
+static void StopServer(int)
+{
+    if (gServer)
+        gServer->Stop();
+}
+
+static int RunServer(const char *address)
+{
+    ChessServer server;
+    if (!server.Listen(address)) {
+        perror(address);
+        return 1;
+    }
+
+    gServer = &server;
+    signal(SIGINT, StopServer);
+    signal(SIGTERM, StopServer);
+    server.Run();
+    gServer = nullptr;
+    return 0;
+}
+
+// chess --analyze FILE [--threads N] [--depth N] [--nodes N] [--movetime MS]
+//                      [--disable pvs,aspiration,null-move,lmr,futility|all]
+//                      [--nnue NETWORK] [--hash MB] [--eval-cache MB]
+//                      [--cache PREFIX]
+static int RunAnalysis(int argc, char **argv)
+{
+    AnalysisOptions options;
+    NnueNetwork     network;
+    options.limits.depth = 6;
+
+    for (int i = 3; i < argc; ++i) {
+        if (i + 1 >= argc) {
+            fprintf(stderr, "%s: missing value\n", argv[i]);
+            return 1;
+        }
+        if (!strcmp(argv[i], "--threads")) {
+            options.threads = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--depth")) {
+            options.limits.depth = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--nodes")) {
+            options.limits.nodes = strtoull(argv[++i], nullptr, 10);
+        } else if (!strcmp(argv[i], "--movetime")) {
+            options.limits.time_ms = strtoull(argv[++i], nullptr, 10);
+        } else if (!strcmp(argv[i], "--nnue")) {
+            if (!network.Load(argv[++i])) {
+                fprintf(stderr, "%s: not a valid network file\n", argv[i]);
+                return 1;
+            }
+            options.network = &network;
+        } else if (!strcmp(argv[i], "--hash")) {
+            options.hash_mb = strtoull(argv[++i], nullptr, 10);
+        } else if (!strcmp(argv[i], "--eval-cache")) {
+            options.eval_cache_mb = strtoull(argv[++i], nullptr, 10);
+        } else if (!strcmp(argv[i], "--cache")) {
+            options.cache_path = argv[++i];
+        } else if (!strcmp(argv[i], "--disable")) {
+            char *saveptr;
+            for (char *name = strtok_r(argv[++i], ",", &saveptr); name;
+                 name = strtok_r(nullptr, ",", &saveptr)) {
+                if (!options.search.Disable(name)) {
+                    fprintf(stderr, "%s: unknown search technique\n", name);
+                    return 1;
+                }
+            }
+        } else {
+            fprintf(stderr, "%s: unknown option\n", argv[i]);
+            return 1;
+        }
+    }
+    if (options.limits.depth < 1) {
+        fprintf(stderr, "--depth must be at least 1\n");
+        return 1;
+    }
+
+    FILE *in = !strcmp(argv[2], "-") ? stdin : fopen(argv[2], "r");
+    if (!in) {
+        perror(argv[2]);
+        return 1;
+    }
+
+    BatchAnalyzer analyzer(options);
+    analyzer.Run(in, stdout);
+
+    if (in != stdin)
+        fclose(in);
+    return 0;
+}
+
+// chess --mate MOVES FILE [--hash MB] [--nodes N] [--movetime MS]
+//
+// One FEN per line in; out comes the FEN followed by "mate N; pv ...",
+// "no mate" or "unknown" when a limit ran out first, and the node count
+// and speed.
+static int RunMate(int argc, char **argv)
+{
+    MateLimits limits;
+    size_t     hash_mb = 16;
+
+    limits.moves = atoi(argv[2]);
+    if (argc < 4 || limits.moves < 1 || limits.moves > kMaxMateMoves) {
+        fprintf(stderr, "usage: chess --mate MOVES FILE [--hash MB] "
+                        "[--nodes N] [--movetime MS], MOVES 1 to %d\n",
+                kMaxMateMoves);
+        return 1;
+    }
+    for (int i = 4; i < argc; ++i) {
+        if (i + 1 >= argc) {
+            fprintf(stderr, "%s: missing value\n", argv[i]);
+            return 1;
+        }
+        if (!strcmp(argv[i], "--hash")) {
+            hash_mb = strtoull(argv[++i], nullptr, 10);
+        } else if (!strcmp(argv[i], "--nodes")) {
+            limits.nodes = strtoull(argv[++i], nullptr, 10);
+        } else if (!strcmp(argv[i], "--movetime")) {
+            limits.time_ms = strtoull(argv[++i], nullptr, 10);
+        } else {
+            fprintf(stderr, "%s: unknown option\n", argv[i]);
+            return 1;
+        }
+    }
+
+    MateSolver solver;
+    if (!solver.Resize(hash_mb)) {
+        fprintf(stderr, "no memory for a %zu MB table\n", hash_mb);
+        return 1;
+    }
+
+    FILE *in = !strcmp(argv[3], "-") ? stdin : fopen(argv[3], "r");
+    if (!in) {
+        perror(argv[3]);
+        return 1;
+    }
+
+    ChessPosition position;
+    char          line[512];
+    while (fgets(line, sizeof(line), in)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (!line[strspn(line, " \t")])
+            continue;
+        if (!position.SetFromFen(line)) {
+            printf("%s; error invalid fen\n", line);
+            continue;
+        }
+
+        // Positions are unrelated, and a full table would only slow the
+        // next one down.
+        solver.Clear();
+        MateResult result = solver.Solve(position, limits);
+
+        printf("%s; ", line);
+        if (result.outcome == MateResult::Mate) {
+            printf("mate %d; pv", result.moves);
+            for (const ChessMove &move : result.main_line)
+                printf(" %s", move.ToString().c_str());
+        } else {
+            printf(result.outcome == MateResult::NoMate ? "no mate"
+                                                        : "unknown");
+        }
+        printf("; nodes %llu; nps %llu\n",
+               static_cast<unsigned long long>(result.nodes),
+               static_cast<unsigned long long>(result.NodesPerSecond()));
+        fflush(stdout);
+    }
+
+    if (in != stdin)
+        fclose(in);
+    return 0;
+}
+
+// Plays a recorded session back into a screen that draws to /dev/null, as
+// fast as the game takes the events, then prints the final board and the
+// latency stats.
+static int RunReplay(const char *path)
+{
+    InputReplay replay;
+    if (!replay.Open(path)) {
+        fprintf(stderr, "%s: not an input recording\n", path);
+        return 1;
+    }
+
+    SCREEN *screen = OpenNullTerminal();
+    if (!screen) {
+        fprintf(stderr, "no terminal description to replay with\n");
+        return 1;
+    }
+
+    uint64_t start_ns = ChessStats::NowNs();
+    char     cells[kBoardSize][kBoardSize + 1] = {};
+    {
+        ChessGame game(&replay);
+        game.Chess();
+
+        for (int y = 0; y < kBoardSize; ++y)
+            for (int x = 0; x < kBoardSize; ++x)
+                cells[y][x] = game.GetBoard().GetCellChar(x, y);
+    }
+    uint64_t elapsed_ns = ChessStats::NowNs() - start_ns;
+    delscreen(screen);
+
+    if (replay.HasError()) {
+        fprintf(stderr, "%s:%d: malformed event\n", path, replay.GetLine());
+        return 1;
+    }
+
+    printf("replayed %s in %.3f ms\n", path, elapsed_ns / 1e6);
+    for (int y = 0; y < kBoardSize; ++y)
+        printf("%s\n", cells[y]);
+    ChessStats::Dump(stdout);
+    return 0;
+}
+
+// Engine games open with a few random moves so that they differ, and are
+// called a draw if they go on too long.
+const int kRandomPlies     = 4;
+const int kMaxWatchedPlies = 400;
+
+static void PlayWatchedGame(int game, const SearchLimits &limits,
+                            SnapshotQueue &queue, const std::atomic<bool> &stop)
+{
+    ChessPosition         position;
+    ChessSearch           search;
+    ChessMoveList         moves;
+    BoardSnapshot         snapshot;
+    BoardSnapshot::Status status = BoardSnapshot::Playing;
+    uint64_t              seed   = 0x9e3779b97f4a7c15ull * (game + 1);
+
+    position.SetFromFen(ChessPosition::kStartFen);
+    for (int ply = 0;; ++ply) {
+        position.GenerateLegalMoves(moves);
+        if (!moves.Size())
+            status = !position.IsInCheck() ? BoardSnapshot::Drawn
+                     : position.GetSideToMove() == TeamID::White
+                         ? BoardSnapshot::BlackWins
+                         : BoardSnapshot::WhiteWins;
+        else if (position.IsRepetition(2) || position.IsFiftyMoveDraw() ||
+                 position.HasInsufficientMaterial() ||
+                 ply >= kMaxWatchedPlies)
+            status = BoardSnapshot::Drawn;
+
+        snapshot.Fill(game, ply, position, status);
+        if (status != BoardSnapshot::Playing) {
+            // A dropped result would never be superseded, so wait for room.
+            while (!queue.TryPush(snapshot) && !stop)
+                std::this_thread::yield();
+            return;
+        }
+        queue.TryPush(snapshot);
+        if (stop)
+            return;
+
+        if (ply < kRandomPlies) {
+            seed ^= seed << 13;
+            seed ^= seed >> 7;
+            seed ^= seed << 17;
+            position.MakeMove(moves[seed % moves.Size()]);
+        } else {
+            // A budget that runs out before the first root move is scored
+            // leaves no best move.
+            ChessMove move = search.Search(position, limits).best_move;
+            position.MakeMove(move.IsNull() ? moves[0] : move);
+        }
+    }
+}
+
+// chess --watch GAMES [--depth N] [--nodes N] [--fps N]
+// Plays GAMES engine games at once, one thread each, and shows them all.
+static int RunWatch(int argc, char **argv)
+{
+    SearchLimits limits;
+    int          games = atoi(argv[2]);
+    int          fps   = 30;
+    limits.depth       = 4;
+
+    for (int i = 3; i < argc; ++i) {
+        if (i + 1 >= argc) {
+            fprintf(stderr, "%s: missing value\n", argv[i]);
+            return 1;
+        }
+        if (!strcmp(argv[i], "--depth")) {
+            limits.depth = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--nodes")) {
+            limits.nodes = strtoull(argv[++i], nullptr, 10);
+        } else if (!strcmp(argv[i], "--fps")) {
+            fps = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "%s: unknown option\n", argv[i]);
+            return 1;
+        }
+    }
+    if (games < 1 || limits.depth < 1 || fps < 1) {
+        fprintf(stderr, "games, --depth and --fps must be at least 1\n");
+        return 1;
+    }
+
+    initscr();
+    cbreak();
+    noecho();
+    curs_set(false);
+    start_color();
+
+    {
+        SpectatorView            view(games, fps);
+        std::atomic<bool>        stop{false};
+        std::atomic<int>         running{games};
+        std::vector<std::thread> threads;
+
+        for (int i = 0; i < games; ++i)
+            threads.emplace_back([&, i]() {
+                PlayWatchedGame(i, limits, view.GetQueue(), stop);
+                running.fetch_sub(1, std::memory_order_release);
+            });
+
+        view.Run([&]() {
+            return running.load(std::memory_order_acquire) == 0;
+        });
+
+        stop = true;
+        for (std::thread &thread : threads)
+            thread.join();
+    }
+
+    endwin();
+    return 0;
+}
+
+int main(int argc, char **argv)
 {
-    ChessGame game;
+    if (argc > 1 && !strcmp(argv[1], "--headless")) {
+        HeadlessGame game;
+        game.Run(stdin, stdout);
+        return 0;
+    }
+
+    if (argc > 2 && !strcmp(argv[1], "--server"))
+        return RunServer(argv[2]);
+
+    if (argc > 2 && !strcmp(argv[1], "--analyze"))
+        return RunAnalysis(argc, argv);
+
+    if (argc > 2 && !strcmp(argv[1], "--mate"))
+        return RunMate(argc, argv);
+
+    if (argc > 2 && !strcmp(argv[1], "--write-nnue")) {
+        if (NnueNetwork::WriteFromClassical(argv[2]))
+            return 0;
+        perror(argv[2]);
+        return 1;
+    }
+
+    if (argc > 2 && !strcmp(argv[1], "--replay"))
+        return RunReplay(argv[2]);
+
+    if (argc > 2 && !strcmp(argv[1], "--watch"))
+        return RunWatch(argc, argv);
+
+    InputRecorder recorder;
+    if (argc > 2 && !strcmp(argv[1], "--record") && !recorder.Open(argv[2])) {
+        perror(argv[2]);
+        return 1;
+    }
+
+    ChessGame game(nullptr, &recorder);
     game.Chess();
     return 0;
 }